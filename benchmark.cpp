@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "machineState.h"
+#include "shiftRegister.h"
+
+//Built in workloads, each an endless loop loaded at 0x100
+
+//Flag setting ALU instructions
+static const std::vector<uint8_t> aluLoop = {
+	0x80,			//ADD    B
+	0x89,			//ADC    C
+	0x92,			//SUB    D
+	0x9b,			//SBB    E
+	0xa4,			//ANA    H
+	0xad,			//XRA    L
+	0xb0,			//ORA    B
+	0xb9,			//CMP    C
+	0x04,			//INR    B
+	0x0d,			//DCR    C
+	0x14,			//INR    D
+	0x1d,			//DCR    E
+	0xc6, 0x13,		//ADI    #$13
+	0xd6, 0x05,		//SUI    #$05
+	0xfe, 0x55,		//CPI    #$55
+	0x27,			//DAA
+	0xc3, 0x00, 0x01	//JMP    $0100
+};
+
+//Short blocks ending in taken and not taken conditional jumps
+static const std::vector<uint8_t> branchLoop = {
+	0x04,			//0100 INR    B
+	0x78,			//0101 MOV    A,B
+	0xe6, 0x03,		//0102 ANI    #$03
+	0xca, 0x0f, 0x01,	//0104 JZ     $010f
+	0xfe, 0x01,		//0107 CPI    #$01
+	0xca, 0x12, 0x01,	//0109 JZ     $0112
+	0xc3, 0x00, 0x01,	//010c JMP    $0100
+	0xd2, 0x00, 0x01,	//010f JNC    $0100
+	0xea, 0x00, 0x01,	//0112 JPE    $0100
+	0xc3, 0x00, 0x01	//0115 JMP    $0100
+};
+
+//Copies and increments a 256 byte buffer through HL and DE
+static const std::vector<uint8_t> memoryLoop = {
+	0x21, 0x00, 0x20,	//0100 LXI    H,$2000
+	0x11, 0x00, 0x30,	//0103 LXI    D,$3000
+	0x0e, 0x00,		//0106 MVI    C,#$00
+	0x7e,			//0108 MOV    A,M
+	0x12,			//0109 STAX   D
+	0x34,			//010a INR    M
+	0x23,			//010b INX    H
+	0x13,			//010c INX    D
+	0x0d,			//010d DCR    C
+	0xc2, 0x08, 0x01,	//010e JNZ    $0108
+	0xc3, 0x00, 0x01	//0111 JMP    $0100
+};
+
+//Register pair addressing, INX/DCX and DAD on BC, DE and HL
+static const std::vector<uint8_t> indirectLoop = {
+	0x21, 0x00, 0x20,	//0100 LXI    H,$2000
+	0x11, 0x00, 0x30,	//0103 LXI    D,$3000
+	0x01, 0x01, 0x00,	//0106 LXI    B,$0001
+	0x7e,			//0109 MOV    A,M
+	0x86,			//010a ADD    M
+	0x77,			//010b MOV    M,A
+	0x12,			//010c STAX   D
+	0x1a,			//010d LDAX   D
+	0x23,			//010e INX    H
+	0x13,			//010f INX    D
+	0x0b,			//0110 DCX    B
+	0x03,			//0111 INX    B
+	0x09,			//0112 DAD    B
+	0x2b,			//0113 DCX    H
+	0xeb,			//0114 XCHG
+	0xeb,			//0115 XCHG
+	0x7c,			//0116 MOV    A,H
+	0xfe, 0x21,		//0117 CPI    #$21
+	0xc2, 0x09, 0x01,	//0119 JNZ    $0109
+	0xc3, 0x00, 0x01	//011c JMP    $0100
+};
+
+//Shifts every byte of a buffer through the shift register by its own
+//address, like the sprite drawing in Space Invaders
+static const std::vector<uint8_t> shiftLoop = {
+	0x21, 0x00, 0x24,	//0100 LXI    H,$2400
+	0x7e,			//0103 MOV    A,M
+	0xd3, 0x04,		//0104 OUT    #$04
+	0x7d,			//0106 MOV    A,L
+	0xd3, 0x02,		//0107 OUT    #$02
+	0xdb, 0x03,		//0109 IN     #$03
+	0x77,			//010b MOV    M,A
+	0x23,			//010c INX    H
+	0x7c,			//010d MOV    A,H
+	0xfe, 0x40,		//010e CPI    #$40
+	0xc2, 0x03, 0x01,	//0110 JNZ    $0103
+	0xc3, 0x00, 0x01	//0113 JMP    $0100
+};
+
+//Nested calls with pushes, pops and a conditional return
+static const std::vector<uint8_t> callLoop = {
+	0x31, 0x00, 0x24,	//0100 LXI    SP,$2400
+	0xcd, 0x10, 0x01,	//0103 CALL   $0110
+	0xcd, 0x10, 0x01,	//0106 CALL   $0110
+	0xc3, 0x03, 0x01,	//0109 JMP    $0103
+	0x00, 0x00, 0x00, 0x00,
+	0x04,			//0110 INR    B
+	0xc5,			//0111 PUSH   B
+	0xcd, 0x18, 0x01,	//0112 CALL   $0118
+	0xc1,			//0115 POP    B
+	0xc9,			//0116 RET
+	0x00,
+	0x05,			//0118 DCR    B
+	0xc8,			//0119 RZ
+	0xc9			//011a RET
+};
+
+//Workloads run one after another, so they can all share one device
+static ShiftRegister shiftRegister;
+
+struct Engine {
+	const char* name;
+	void (MachineState::*run)(uint64_t);
+};
+
+static const Engine engines[] = {
+	{"switch", &MachineState::runSwitch},
+	{"table", &MachineState::runTable},
+#ifdef HAVE_COMPUTED_GOTO
+	{"threaded", &MachineState::runThreaded},
+#endif
+	{"cached", &MachineState::runCached},
+#ifdef HAVE_JIT
+	{"jit", &MachineState::runJit},
+#endif
+};
+
+struct Workload {
+	std::string name;
+	std::function<MachineState*()> makeState;
+};
+
+//Timings of every repetition of one workload on one engine
+struct Result {
+	std::string workload;
+	const char* engine;
+	uint64_t instructions;
+	uint64_t cycles;
+	std::vector<double> seconds; //Sorted, fastest first
+
+	double min() const { return seconds.front(); }
+	double median() const { return seconds[seconds.size() / 2]; }
+	double max() const { return seconds.back(); }
+};
+
+enum Format { FORMAT_HUMAN, FORMAT_CSV, FORMAT_JSON };
+
+static Result measure(const Workload& workload, const Engine& engine, uint64_t count, unsigned int repetitions) {
+	Result result = {workload.name, engine.name, count, 0, {}};
+	for(unsigned int i = 0; i < repetitions; i++) {
+		std::unique_ptr<MachineState> state(workload.makeState());
+		auto start = std::chrono::steady_clock::now();
+		((*state).*engine.run)(count);
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		result.seconds.push_back(elapsed.count());
+		result.cycles = state->cycleCount();
+	}
+	std::sort(result.seconds.begin(), result.seconds.end());
+	return result;
+}
+
+//MIPS, emulated MHz and ns/instruction are all reported for the fastest,
+//median and slowest repetition
+static void printHuman(const std::vector<Result>& results) {
+	std::cout << std::left << std::setw(10) << "workload" << std::setw(10) << "engine" << std::right
+				<< std::setw(24) << "MIPS min/med/max" << std::setw(24) << "MHz min/med/max"
+				<< std::setw(24) << "ns/instr min/med/max" << "\n";
+	for(const Result& result : results) {
+		std::ostringstream mips, mhz, ns;
+		mips << std::fixed << std::setprecision(1) << result.instructions / result.max() / 1e6 << "/"
+				<< result.instructions / result.median() / 1e6 << "/" << result.instructions / result.min() / 1e6;
+		mhz << std::fixed << std::setprecision(1) << result.cycles / result.max() / 1e6 << "/"
+				<< result.cycles / result.median() / 1e6 << "/" << result.cycles / result.min() / 1e6;
+		ns << std::fixed << std::setprecision(2) << result.min() / result.instructions * 1e9 << "/"
+				<< result.median() / result.instructions * 1e9 << "/" << result.max() / result.instructions * 1e9;
+		std::cout << std::left << std::setw(10) << result.workload << std::setw(10) << result.engine << std::right
+					<< std::setw(24) << mips.str() << std::setw(24) << mhz.str() << std::setw(24) << ns.str() << "\n";
+	}
+	std::cout << std::flush;
+}
+
+static void printCSV(const std::vector<Result>& results) {
+	std::cout << "workload,engine,instructions,cycles,repetitions,min_s,median_s,max_s,"
+				<< "mips_median,mhz_median,ns_per_instruction_median\n";
+	for(const Result& result : results) {
+		std::cout << result.workload << "," << result.engine << "," << result.instructions << "," << result.cycles << ","
+					<< result.seconds.size() << "," << result.min() << "," << result.median() << "," << result.max() << ","
+					<< result.instructions / result.median() / 1e6 << "," << result.cycles / result.median() / 1e6 << ","
+					<< result.median() / result.instructions * 1e9 << "\n";
+	}
+	std::cout << std::flush;
+}
+
+static void printJSON(const std::vector<Result>& results) {
+	std::cout << "[\n";
+	for(size_t i = 0; i < results.size(); i++) {
+		const Result& result = results[i];
+		std::cout << "  {\"workload\": \"" << result.workload << "\", \"engine\": \"" << result.engine
+					<< "\", \"instructions\": " << result.instructions << ", \"cycles\": " << result.cycles
+					<< ", \"seconds\": [";
+		for(size_t j = 0; j < result.seconds.size(); j++)
+			std::cout << (j > 0 ? ", " : "") << result.seconds[j];
+		std::cout << "], \"mips_median\": " << result.instructions / result.median() / 1e6
+					<< ", \"mhz_median\": " << result.cycles / result.median() / 1e6
+					<< ", \"ns_per_instruction_median\": " << result.median() / result.instructions * 1e9
+					<< "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	std::cout << "]" << std::endl;
+}
+
+static void usage(const char* program) {
+	std::cerr << "Usage: " << program << " [--instructions N] [--repetitions N] [--csv | --json] [romFile...]" << std::endl;
+	exit(1);
+}
+
+//A whole decimal argument, false if any of it isn't a digit or it doesn't
+//fit in max
+static bool parseNumber(const std::string& text, uint64_t max, uint64_t& value) {
+	if(text.empty() || !std::isdigit((unsigned char) text[0]))
+		return false;
+	char* end;
+	errno = 0;
+	value = std::strtoull(text.c_str(), &end, 10);
+	return *end == '\0' && errno == 0 && value <= max;
+}
+
+//Runs every workload through every dispatch engine and reports the speed
+int main(int argc, char* argv[]) {
+
+	uint64_t count = 20000000;
+	unsigned int repetitions = 5;
+	uint64_t number;
+	Format format = FORMAT_HUMAN;
+	std::vector<Workload> workloads = {
+		{"alu", [] { return new MachineState(aluLoop, 0x100); }},
+		{"branch", [] { return new MachineState(branchLoop, 0x100); }},
+		{"memory", [] { return new MachineState(memoryLoop, 0x100); }},
+		{"call", [] { return new MachineState(callLoop, 0x100); }},
+		{"indirect", [] { return new MachineState(indirectLoop, 0x100); }},
+		{"shift", [] {
+			MachineState* state = new MachineState(shiftLoop, 0x100);
+			state->mapShiftRegister(&shiftRegister);
+			return state;
+		}},
+	};
+
+	for(int i = 1; i < argc; i++) {
+		const std::string arg = argv[i];
+		if(arg == "--instructions" && i + 1 < argc && parseNumber(argv[i + 1], UINT64_MAX, count))
+			i++;
+		else if(arg == "--repetitions" && i + 1 < argc && parseNumber(argv[i + 1], UINT_MAX, number)) {
+			repetitions = number;
+			i++;
+		}
+		else if(arg == "--csv")
+			format = FORMAT_CSV;
+		else if(arg == "--json")
+			format = FORMAT_JSON;
+		else if(arg.length() > 0 && arg[0] == '-')
+			usage(argv[0]);
+		else {
+			//ROMs such as the CPU diagnostic are named after their file
+			const std::string fileName = arg;
+			workloads.push_back({fileName.substr(fileName.find_last_of('/') + 1),
+									[fileName] { return new MachineState(fileName); }});
+		}
+	}
+	if(count == 0 || repetitions == 0)
+		usage(argv[0]);
+
+	std::vector<Result> results;
+	for(const Workload& workload : workloads) {
+		for(const Engine& engine : engines)
+			results.push_back(measure(workload, engine, count, repetitions));
+	}
+
+	if(format == FORMAT_CSV)
+		printCSV(results);
+	else if(format == FORMAT_JSON)
+		printJSON(results);
+	else
+		printHuman(results);
+
+	return 0;
+
+}
@@ -0,0 +1,106 @@
+#include "debugger.h"
+
+Debugger::Debugger(MachineState& state, PortDevice* ports) : state(state), inputs(state, ports), history(state, CHECKPOINT_CYCLES), breakpoints(0x10000, false) {
+	this->state.setDefaultPorts(&this->inputs);
+	this->history.checkpoint();
+}
+
+Debugger::~Debugger() {
+	this->state.setDefaultPorts(nullptr);
+}
+
+bool Debugger::toggleBreakpoint(uint16_t address) {
+	this->breakpoints[address] = !this->breakpoints[address];
+	return this->breakpoints[address];
+}
+
+uint64_t Debugger::step(uint64_t count) {
+	uint64_t executed = 0;
+	for(; executed < count && this->state.runInstruction() != 0; executed++)
+		this->history.record();
+	return executed;
+}
+
+bool Debugger::continueForward(uint64_t limit) {
+	for(uint64_t executed = 0; executed < limit && !this->state.isDone(); executed++) {
+		if(this->state.runInstruction() == 0)
+			return false;
+		this->history.record();
+		if(!this->state.isHalted() && this->breakpoints[this->state.getPC()])
+			return true;
+	}
+	return false;
+}
+
+uint64_t Debugger::stepBack(uint64_t count) {
+	//Count the instructions from each checkpoint back to now until there are
+	//enough, then find the cycle the one count back started on
+	const MachineState::Snapshot present = this->state.snapshot();
+	uint64_t end = present.cycles, later = 0;
+	for(size_t index = this->history.checkpoints(); index-- > 0;) {
+		this->history.restoreCheckpoint(index);
+		uint64_t steps = 0;
+		while(this->state.cycleCount() < end && this->state.runInstruction() != 0)
+			steps++;
+		if(steps + later >= count) {
+			this->history.restoreCheckpoint(index);
+			for(uint64_t i = steps + later - count; i > 0; i--)
+				this->state.runInstruction();
+			const uint64_t cycle = this->state.cycleCount();
+			this->state.restore(present);
+			this->history.rewindTo(cycle);
+			return count;
+		}
+		later += steps;
+		end = this->history.checkpointCycles(index);
+	}
+	this->state.restore(present);
+	this->history.rewindTo(this->history.oldest());
+	return later;
+}
+
+//Replays history a stretch between checkpoints at a time, newest first,
+//asking match after every instruction whether it was the one looked for,
+//given where it started and the watchpoint hits before it. Finds the newest
+//match before now and puts the machine back where it was.
+template<typename Match> bool Debugger::searchBack(Match match, uint64_t& cycle, uint16_t& pc) {
+	const MachineState::Snapshot present = this->state.snapshot();
+	uint64_t end = present.cycles;
+	bool found = false;
+	for(size_t index = this->history.checkpoints(); index-- > 0 && !found;) {
+		this->history.restoreCheckpoint(index);
+		while(this->state.cycleCount() < end) {
+			const uint64_t at = this->state.cycleCount();
+			const uint16_t from = this->state.getPC();
+			const bool halted = this->state.isHalted();
+			const uint64_t hits = this->state.watchpointHits();
+			if(this->state.runInstruction() == 0)
+				break;
+			if(match(from, halted, hits)) {
+				found = true;
+				cycle = at;
+				pc = from;
+			}
+		}
+		end = this->history.checkpointCycles(index);
+	}
+	this->state.restore(present);
+	return found;
+}
+
+bool Debugger::reverseContinue() {
+	uint64_t cycle;
+	uint16_t pc;
+	if(!this->searchBack([this](uint16_t from, bool halted, uint64_t) { return !halted && this->breakpoints[from]; }, cycle, pc)) {
+		this->history.rewindTo(this->history.oldest());
+		return false;
+	}
+	return this->history.rewindTo(cycle);
+}
+
+bool Debugger::lastWrite(uint16_t address, uint64_t& cycle, uint16_t& pc) {
+	this->state.setWatchpoint(address);
+	const bool found = this->searchBack([this](uint16_t, bool, uint64_t hits) { return this->state.watchpointHits() != hits; }, cycle, pc);
+	this->state.setWatchpoint(-1);
+	return found;
+}
@@ -0,0 +1,53 @@
+#ifndef debugger_h
+#define debugger_h
+
+#include <cstdint>
+#include <vector>
+
+#include "inputLog.h"
+#include "machineState.h"
+#include "rewindBuffer.h"
+
+//Runs a machine forwards and backwards for the interactive mode. Going
+//forward it takes a checkpoint every CHECKPOINT_CYCLES and logs what IN
+//reads. Going back restores the checkpoint before where it needs to be and
+//replays from there, so searching back for a breakpoint or a store costs
+//replaying one stretch between checkpoints at a time with nothing printed.
+class Debugger {
+public:
+	static const uint64_t CHECKPOINT_CYCLES = 100000;
+
+	//Takes over the machine's default ports, reading from ports when given
+	Debugger(MachineState& state, PortDevice* ports = nullptr);
+	Debugger(const Debugger&) = delete;
+	Debugger& operator=(const Debugger&) = delete;
+	~Debugger();
+
+	bool toggleBreakpoint(uint16_t address); //True if it is now set
+
+	//Each returns the instructions actually run or undone. Forward stops
+	//when the CPU halts with nothing to wake it, back at the oldest checkpoint.
+	uint64_t step(uint64_t count);
+	uint64_t stepBack(uint64_t count);
+
+	//Runs to the next or back to the previous time an instruction at a
+	//breakpoint was about to run. False, having gone as far as it could, if
+	//there wasn't one.
+	bool continueForward(uint64_t limit = UINT64_MAX);
+	bool reverseContinue();
+
+	//The cycle and pc of the newest instruction before now that stored to
+	//address, leaving the machine where it is. False if none has since the
+	//oldest checkpoint.
+	bool lastWrite(uint16_t address, uint64_t& cycle, uint16_t& pc);
+
+private:
+	MachineState& state;
+	InputLog inputs;
+	RewindBuffer history;
+	std::vector<bool> breakpoints;
+
+	template<typename Match> bool searchBack(Match match, uint64_t& cycle, uint16_t& pc);
+};
+
+#endif
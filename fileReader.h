@@ -0,0 +1,54 @@
+#ifndef fileReader_h
+#define fileReader_h
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_PREAD
+#endif
+
+//Reads parts of a file by offset straight into the caller's memory, with
+//pread where there is one. Mapping the file was tried and cost more in mmap
+//and munmap than reading the few dozen K these files hold.
+class FileReader {
+public:
+#ifdef HAVE_PREAD
+	explicit FileReader(const std::string& fileName) : file(open(fileName.c_str(), O_RDONLY)) {}
+	~FileReader() {
+		if(this->file >= 0)
+			close(this->file);
+	}
+	FileReader(const FileReader&) = delete;
+	FileReader& operator=(const FileReader&) = delete;
+
+	bool isOpen() const { return file >= 0; }
+	uint64_t size() const {
+		struct stat info;
+		return this->file >= 0 && fstat(this->file, &info) == 0 ? info.st_size : 0;
+	}
+	bool read(void* into, size_t bytes, uint64_t offset) { return pread(this->file, into, bytes, offset) == (ssize_t) bytes; }
+
+private:
+	const int file;
+#else
+	explicit FileReader(const std::string& fileName) : input(fileName, std::ios::in | std::ios::binary | std::ios::ate) {}
+
+	bool isOpen() const { return input.is_open(); }
+	uint64_t size() { return this->input ? (uint64_t) this->input.tellg() : 0; }
+	bool read(void* into, size_t bytes, uint64_t offset) {
+		this->input.seekg(offset, std::ios::beg);
+		this->input.read((char*) into, bytes);
+		return this->input.good();
+	}
+
+private:
+	std::ifstream input;
+#endif
+};
+
+#endif
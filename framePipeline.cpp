@@ -0,0 +1,62 @@
+#include "framePipeline.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "machineState.h"
+
+//How long the consumer thread sleeps when it finds the ring empty
+static const std::chrono::microseconds IDLE_WAIT(200);
+
+FramePipeline::FramePipeline(unsigned int slots) : slots(slots > 0 ? slots : 1), frames(new Frame[this->slots]) {}
+
+bool FramePipeline::publish(const MachineState& state) {
+	const uint64_t written = this->head.load(std::memory_order_relaxed);
+	const uint64_t number = written + this->droppedFrames.load(std::memory_order_relaxed);
+	if(written - this->tail.load(std::memory_order_acquire) == this->slots) {
+		this->droppedFrames.store(this->droppedFrames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Frame& frame = this->frames[written % this->slots];
+	frame.number = number;
+	frame.cycles = state.cycleCount();
+	std::memcpy(frame.vram, state.getMemory() + Video::VRAM_START, Video::VRAM_SIZE);
+	//The release hands the copied bytes over along with the slot
+	this->head.store(written + 1, std::memory_order_release);
+	return true;
+}
+
+bool FramePipeline::consume(const Consumer& consumer) {
+	const uint64_t read = this->tail.load(std::memory_order_relaxed);
+	if(read == this->head.load(std::memory_order_acquire))
+		return false;
+	consumer(this->frames[read % this->slots]);
+	//Only now may the producer write over the slot
+	this->tail.store(read + 1, std::memory_order_release);
+	return true;
+}
+
+void FramePipeline::start(Consumer consumer) {
+	this->stop();
+	this->running.store(true);
+	this->consumerThread = std::thread([this, consumer] {
+		while(true) {
+			if(this->consume(consumer))
+				continue;
+			if(!this->running.load()) {
+				//Whatever was published before stop is visible now
+				while(this->consume(consumer));
+				break;
+			}
+			std::this_thread::sleep_for(IDLE_WAIT);
+		}
+	});
+}
+
+void FramePipeline::stop() {
+	if(!this->consumerThread.joinable())
+		return;
+	this->running.store(false);
+	this->consumerThread.join();
+}
@@ -0,0 +1,62 @@
+#ifndef framePipeline_h
+#define framePipeline_h
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "video.h"
+
+class MachineState;
+
+//Hands VRAM snapshots from the emulation thread to a thread that converts or
+//encodes them. The ring of frames is allocated up front and only ever has one
+//producer and one consumer, so publishing is a copy and two atomic operations,
+//never a lock or an allocation. When the consumer falls behind the newest
+//frames are dropped and counted rather than making the emulator wait.
+class FramePipeline {
+public:
+	struct Frame {
+		uint64_t number; //Counts every publish, gaps are dropped frames
+		uint64_t cycles; //Clock cycle the snapshot was taken on
+		uint8_t vram[Video::VRAM_SIZE];
+	};
+	typedef std::function<void(const Frame&)> Consumer;
+
+	explicit FramePipeline(unsigned int slots = 8);
+	FramePipeline(const FramePipeline&) = delete;
+	FramePipeline& operator=(const FramePipeline&) = delete;
+	~FramePipeline() { stop(); }
+
+	//Emulation thread. False if the ring was full and the frame was dropped.
+	bool publish(const MachineState& state);
+
+	//Runs consumer on its own thread for every frame until stop, which
+	//waits for the frames already published
+	void start(Consumer consumer);
+	void stop();
+
+	//Without a consumer thread, hands the oldest frame to consumer on this one
+	bool consume(const Consumer& consumer);
+
+	uint64_t published() const { return head.load(std::memory_order_relaxed); }
+	uint64_t dropped() const { return droppedFrames.load(std::memory_order_relaxed); }
+	uint64_t consumed() const { return tail.load(std::memory_order_relaxed); }
+
+private:
+	const unsigned int slots;
+	std::unique_ptr<Frame[]> frames;
+
+	//Frames ever written and read. What each thread writes sits on its own
+	//cache line so the two don't keep taking it from each other.
+	alignas(64) std::atomic<uint64_t> head{0};
+	std::atomic<uint64_t> droppedFrames{0};
+	alignas(64) std::atomic<uint64_t> tail{0};
+
+	std::thread consumerThread;
+	std::atomic<bool> running{false};
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef inputLog_h
+#define inputLog_h
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "machineState.h"
+
+//Goes between a machine and the devices on its ports and remembers what
+//every IN read and on which cycle. Once a debugger takes the machine back
+//over cycles it already ran, an IN reads what it read the first time rather
+//than what the hardware says now, and an OUT isn't sent again. Anything up
+//to the newest cycle the log has seen counts as a replay.
+class InputLog : public PortDevice {
+public:
+	InputLog(const MachineState& state, PortDevice* source) : state(state), source(source != nullptr ? source : &none) {}
+
+	uint8_t in(uint8_t port) override {
+		const uint64_t now = this->state.cycleCount();
+		if(now <= this->latest) {
+			auto found = std::lower_bound(this->reads.begin(), this->reads.end(), now,
+											[](const Read& read, uint64_t cycle) { return read.cycle < cycle; });
+			if(found != this->reads.end() && found->cycle == now)
+				return found->value;
+		}
+		const uint8_t value = this->source->in(port);
+		if(now > this->latest) {
+			this->reads.push_back({now, value});
+			this->latest = now;
+		}
+		return value;
+	}
+
+	void out(uint8_t port, uint8_t value) override {
+		const uint64_t now = this->state.cycleCount();
+		if(now <= this->latest)
+			return;
+		this->latest = now;
+		this->source->out(port, value);
+	}
+
+	size_t size() const { return reads.size(); }
+
+private:
+	struct Read {
+		uint64_t cycle;
+		uint8_t value;
+	};
+
+	const MachineState& state;
+	PortDevice none;
+	PortDevice* source;
+	std::vector<Read> reads;
+	uint64_t latest = 0; //Cycle of the newest IN or OUT that went to the source
+};
+
+#endif
@@ -0,0 +1,428 @@
+#include "machineState.h"
+
+#ifdef HAVE_JIT
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "jit.h"
+#include "shiftRegister.h"
+
+//Blocks run this many times in the interpreter before they get compiled
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD 16
+#endif
+
+JitBuffer::JitBuffer(size_t size) : used(0), size(size) {
+	void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(memory == MAP_FAILED) {
+		std::cerr << "Could not allocate executable memory for the JIT" << std::endl;
+		exit(1);
+	}
+	code = (unsigned char*) memory;
+}
+
+JitBuffer::~JitBuffer() {
+	munmap(code, size);
+}
+
+namespace {
+
+//Host registers, only the low 8 bit forms and AH are used
+enum HostReg : uint8_t { AL = 0, CL = 1, DL = 2, AH = 4 };
+
+//Writes x86-64 machine code. Every guest field is addressed as [rbx + disp32]
+//with rbx holding the MachineState pointer for the whole block, except A which
+//stays in r12b and only goes back to memory around handler calls and on exit.
+class Emitter {
+public:
+	Emitter(unsigned char* start, int32_t fieldA, int32_t fieldCycles)
+		: start(start), out(start), fieldA(fieldA), fieldCycles(fieldCycles) {}
+
+	size_t size() const { return out - start; }
+
+	void byte(uint8_t value) { *out++ = value; }
+	void bytes(std::initializer_list<uint8_t> values) { for(uint8_t value : values) byte(value); }
+	void imm16(uint16_t value) { std::memcpy(out, &value, 2); out += 2; }
+	void imm32(uint32_t value) { std::memcpy(out, &value, 4); out += 4; }
+	void imm64(uint64_t value) { std::memcpy(out, &value, 8); out += 8; }
+
+	//opcode with a [rbx + disp32] memory operand and reg/extension field ext
+	void rbxOperand(std::initializer_list<uint8_t> opcode, uint8_t ext, int32_t disp) {
+		bytes(opcode);
+		byte(0x80 | (ext << 3) | 0x03);
+		imm32(disp);
+	}
+
+	//Single byte opcode on a guest register, A is r12b
+	void guestOperand(uint8_t opcode, uint8_t ext, int32_t disp) {
+		if(disp == this->fieldA)
+			bytes({0x41, opcode, (uint8_t) (0xc4 | (ext << 3))});
+		else
+			rbxOperand({opcode}, ext, disp);
+	}
+
+	//Loads zero extend into the whole host register, so the flag bits LAHF
+	//leaves in AH never turn into a partial register stall. AH can't be
+	//encoded next to r12b, so it never moves to or from A.
+	void load8(HostReg reg, int32_t disp) {
+		if(disp == this->fieldA)
+			bytes({0x41, 0x0f, 0xb6, (uint8_t) (0xc4 | (reg << 3))});	//movzx reg, r12b
+		else
+			rbxOperand({0x0f, 0xb6}, reg, disp);						//movzx reg, byte
+	}
+	void store8(int32_t disp, HostReg reg) {
+		if(disp == this->fieldA)
+			bytes({0x41, 0x88, (uint8_t) (0xc4 | (reg << 3))});	//mov r12b, reg
+		else
+			rbxOperand({0x88}, reg, disp);
+	}
+	void storeImm8(int32_t disp, uint8_t value) {
+		if(disp == this->fieldA)
+			bytes({0x41, 0xb4, value});	//mov r12b, imm
+		else {
+			rbxOperand({0xc6}, 0, disp);
+			byte(value);
+		}
+	}
+	void storeImm16(int32_t disp, uint16_t value) { rbxOperand({0x66, 0xc7}, 0, disp); imm16(value); }
+
+	//op r12b, cl for one of the x86 "op r/m8, r8" ALU opcodes
+	void aluA(uint8_t opcode) { bytes({0x41, opcode, 0xcc}); }
+
+	void movRdx(const void* pointer) { bytes({0x48, 0xba}); imm64((uint64_t) pointer); }
+
+	void spillA() { rbxOperand({0x44, 0x88}, 4, this->fieldA); }
+	void reloadA() { rbxOperand({0x44, 0x8a}, 4, this->fieldA); }
+
+	//eax = a register pair, stored as one little endian word
+	void loadPair(int32_t pair) { rbxOperand({0x0f, 0xb7}, 0, pair); }	//movzx eax, word
+
+	//cl = memory[eax]
+	void loadMemoryAtEax(int32_t memoryField) {
+		rbxOperand({0x48, 0x8b}, 6, memoryField);	//mov rsi, [memory]
+		bytes({0x0f, 0xb6, 0x0c, 0x06});			//movzx ecx, byte [rsi + rax]
+	}
+
+	void prologue() {
+		bytes({0x53});				//push rbx
+		bytes({0x41, 0x54});		//push r12
+		bytes({0x50});				//push rax, keeps calls 16 byte aligned
+		bytes({0x48, 0x89, 0xfb});	//mov rbx, rdi
+		reloadA();
+	}
+
+	//Inline instructions add their cycles on the way out, handlers count their own
+	void epilogue(uint32_t executed, uint32_t cycles, bool spill) {
+		if(spill)
+			spillA();
+		if(cycles > 0) {
+			rbxOperand({0x48, 0x81}, 0, this->fieldCycles);	//add qword [cycles], imm
+			imm32(cycles);
+		}
+		byte(0xb8);					//mov eax, executed
+		imm32(executed);
+		bytes({0x59});				//pop rcx
+		bytes({0x41, 0x5c});		//pop r12
+		bytes({0x5b, 0xc3});		//pop rbx, ret
+	}
+
+	void callHandler(void (*handler)(MachineState&)) {
+		spillA();
+		bytes({0x48, 0x89, 0xdf});	//mov rdi, rbx
+		bytes({0x48, 0xb8});		//mov rax, handler
+		imm64((uint64_t) handler);
+		bytes({0xff, 0xd0});		//call rax
+		reloadA();
+	}
+
+	//Leaves the block with executed instructions when a store hit cached code,
+	//A is already in memory right after a handler call
+	void exitIfInvalidated(int32_t flagField, uint32_t executed, uint32_t cycles) {
+		rbxOperand({0x80}, 7, flagField);	//cmp byte [flag], 0
+		byte(0x00);
+		bytes({0x74, 0x00});				//je past the epilogue
+		unsigned char* skip = this->out;
+		epilogue(executed, cycles, false);
+		skip[-1] = this->out - skip;
+	}
+
+private:
+	unsigned char* start;
+	unsigned char* out;
+	int32_t fieldA;
+	int32_t fieldCycles;
+};
+
+//x86 ALU opcodes of the form "op r/m8, r8", indexed like the 8080 ALU group
+const uint8_t hostAluOp[8] = {
+	0x00,	//ADD
+	0x10,	//ADC
+	0x28,	//SUB
+	0x18,	//SBB
+	0x20,	//ANA
+	0x30,	//XRA
+	0x08,	//ORA
+	0x38	//CMP
+};
+
+bool isNop(uint8_t op) {
+	return op == 0x00 || op == 0x08 || op == 0x10 || op == 0x18 || op == 0x20 || op == 0x28 || op == 0x30
+		|| op == 0x38 || op == 0xcb || op == 0xd9 || op == 0xdd || op == 0xed || op == 0xfd;
+}
+
+//Instructions that may store to memory, anything with a handler after these
+//has to check whether the store invalidated the running block
+bool mayWrite(uint8_t op) {
+	switch(op) {
+		case 0x02: case 0x12: case 0x22: case 0x32: case 0x34: case 0x35: case 0x36:
+		case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: case 0x77:
+		case 0xc5: case 0xd5: case 0xe5: case 0xf5: case 0xe3:
+			return true;
+	}
+	return false;
+}
+
+}
+
+bool MachineState::compileBlock(Block* block, uint16_t start) {
+	if(!this->jit)
+		this->jit.reset(new JitBuffer(JIT_BUFFER_SIZE));
+	//No instruction takes more than about 80 bytes, a handler call followed
+	//by the check for an invalidated block being the largest
+	if(this->jit->available() < MAX_BLOCK_OPS * 128) {
+		this->flushBlocks();
+		this->jit->clear();
+		return false;
+	}
+
+	//Field offsets inside the pinned MachineState
+	const char* base = (const char*) this;
+	auto field = [base](const void* member) { return (int32_t) ((const char*) member - base); };
+	const int32_t regs[8] = {
+		field(&this->b), field(&this->c), field(&this->d), field(&this->e),
+		field(&this->h), field(&this->l), -1, field(&this->a)
+	};
+	const int32_t pairs[4] = {field(&this->bc), field(&this->de), field(&this->hl), field(&this->sp)};
+	const int32_t fieldA = regs[7], fieldF = field(&this->f), fieldPC = field(&this->pc);
+	const int32_t fieldMemory = field(&this->memory);
+	const int32_t fieldInvalidated = field(&this->blockInvalidated);
+
+	Emitter emit(this->jit->begin(), fieldA, field(&this->cycles));
+	emit.prologue();
+
+	uint16_t address = start;
+	uint32_t executed = 0;
+	uint32_t inlineCycles = 0;
+	//Loads can only be inlined while no page belongs to a MemoryDevice
+	const bool plainLoads = this->devicePages == 0;
+	bool pcCurrent = false;	//Whether this->pc already holds the address after the last instruction
+	for(size_t i = 0; i < block->ops.size(); i++) {
+		uint8_t op = this->memory[address];
+		uint8_t imm1 = this->memory[(uint16_t) (address + 1)];
+		//IN, OUT and HLT go back to the interpreter, apart from the shift
+		//register whose ports are translated inline
+		const bool shiftPort = this->shiftRegister != nullptr
+			&& ((op == 0xdb && this->inputPorts[imm1] == this->shiftRegister)
+				|| (op == 0xd3 && this->outputPorts[imm1] == this->shiftRegister));
+		if((op == 0xdb || op == 0xd3 || op == 0x76) && !shiftPort)
+			break;
+		uint8_t imm2 = this->memory[(uint16_t) (address + 2)];
+		uint16_t next = address + opcodes[op].length;
+		uint8_t dst = (op >> 3) & 0x07, src = op & 0x07;
+		bool native = true;
+
+		if(isNop(op)) {
+		}
+		else if(op >= 0x40 && op < 0x80 && dst != 6 && (src != 6 || plainLoads)) { //MOV r,r and MOV r,M
+			if(src == 6) {
+				emit.loadPair(pairs[2]);
+				emit.loadMemoryAtEax(fieldMemory);
+			}
+			else
+				emit.load8(CL, regs[src]);
+			emit.store8(regs[dst], CL);
+		}
+		else if(op < 0x40 && (op & 0x07) == 0x06 && dst != 6) { //MVI r
+			emit.storeImm8(regs[dst], imm1);
+		}
+		else if(op < 0x40 && (op & 0x0f) == 0x01) { //LXI
+			emit.storeImm16(pairs[op >> 4], (imm2 << 8) | imm1);
+		}
+		else if(op < 0x40 && ((op & 0x0f) == 0x03 || (op & 0x0f) == 0x0b)) { //INX, DCX
+			emit.rbxOperand({0x66, 0xff}, (op & 0x0f) == 0x03 ? 0 : 1, pairs[op >> 4]);	//inc/dec word
+		}
+		else if(op < 0x40 && ((op & 0x07) == 0x04 || (op & 0x07) == 0x05) && dst != 6) { //INR, DCR
+			bool inc = (op & 0x07) == 0x04;
+			emit.guestOperand(0xfe, inc ? 0 : 1, regs[dst]);	//inc/dec byte
+			emit.byte(0x9f);									//lahf
+			if(!inc)
+				emit.bytes({0x80, 0xf4, FLAG_AC});				//xor ah, AC, x86 AF is a borrow
+			emit.bytes({0x80, 0xe4, FLAG_MASK & ~FLAG_CY});		//and ah
+			emit.load8(CL, fieldF);
+			emit.bytes({0x80, 0xe1, FLAG_CY});					//and cl, CY
+			emit.bytes({0x08, 0xcc});							//or ah, cl
+			emit.store8(fieldF, AH);
+		}
+		else if((op >= 0x80 && op < 0xc0 && (src != 6 || plainLoads)) || (op >= 0xc0 && (op & 0x07) == 0x06)) {
+			//ALU with a register, M or immediate operand. LAHF lays the host
+			//flags out exactly like the 8080 PSW byte.
+			if(op >= 0xc0)
+			{
+				emit.byte(0xb9);			//mov ecx, imm
+				emit.imm32(imm1);
+			}
+			else if(src == 6) {
+				emit.loadPair(pairs[2]);
+				emit.loadMemoryAtEax(fieldMemory);
+			}
+			else
+				emit.load8(CL, regs[src]);
+			if(dst == 1 || dst == 3) {
+				emit.load8(DL, fieldF);
+				emit.bytes({0xd0, 0xea});		//shr dl, 1 puts CY in the host carry
+			}
+			else if(dst == 4) {
+				//ANA sets AC from bit 3 of the operands ORed together
+				emit.load8(DL, fieldA);
+				emit.bytes({0x08, 0xca});		//or dl, cl
+				emit.bytes({0x80, 0xe2, 0x08});	//and dl, 8
+				emit.bytes({0x00, 0xd2});		//add dl, dl
+			}
+			emit.aluA(hostAluOp[dst]);
+			emit.byte(0x9f);					//lahf
+			if(dst == 2 || dst == 3 || dst == 7)
+				emit.bytes({0x80, 0xf4, FLAG_AC});	//8080 AC on subtraction is no borrow
+			emit.bytes({0x80, 0xe4, (uint8_t) (dst >= 4 && dst <= 6 ? FLAG_S | FLAG_Z | FLAG_P : FLAG_MASK)});
+			if(dst == 4)
+				emit.bytes({0x08, 0xd4});		//or ah, dl
+			emit.store8(fieldF, AH);
+		}
+		else if((op == 0x0a || op == 0x1a) && plainLoads) { //LDAX
+			emit.loadPair(pairs[op >> 4]);
+			emit.loadMemoryAtEax(fieldMemory);
+			emit.store8(fieldA, CL);
+		}
+		else if(op == 0x3a && plainLoads) { //LDA
+			emit.bytes({0xb8});		//mov eax, address
+			emit.imm32((imm2 << 8) | imm1);
+			emit.loadMemoryAtEax(fieldMemory);
+			emit.store8(fieldA, CL);
+		}
+		else if(op == 0xeb) { //XCHG
+			emit.loadPair(pairs[1]);
+			emit.rbxOperand({0x0f, 0xb7}, CL, pairs[2]);	//movzx ecx, word [hl]
+			emit.rbxOperand({0x66, 0x89}, CL, pairs[1]);	//mov word [de], cx
+			emit.rbxOperand({0x66, 0x89}, AL, pairs[2]);	//mov word [hl], ax
+		}
+		else if(op == 0x2f) { //CMA
+			emit.guestOperand(0xf6, 2, fieldA);
+		}
+		else if(op == 0x37 || op == 0x3f) { //STC, CMC
+			emit.rbxOperand({0x80}, op == 0x37 ? 1 : 6, fieldF);
+			emit.byte(FLAG_CY);
+		}
+		else if(shiftPort) {
+			ShiftRegister* device = this->shiftRegister;
+			if(op == 0xdb) { //IN, A = value >> (8 - offset)
+				emit.movRdx(&device->value);
+				emit.bytes({0x0f, 0xb7, 0x02});				//movzx eax, word [rdx]
+				emit.movRdx(&device->offset);
+				emit.bytes({0xb9, 0x08, 0x00, 0x00, 0x00});	//mov ecx, 8
+				emit.bytes({0x2a, 0x0a});					//sub cl, byte [rdx]
+				emit.bytes({0xd3, 0xe8});					//shr eax, cl
+				emit.store8(fieldA, AL);
+			}
+			else if(imm1 == device->offsetPort) { //OUT, offset = A & 7
+				emit.movRdx(&device->offset);
+				emit.load8(CL, fieldA);
+				emit.bytes({0x83, 0xe1, 0x07});				//and ecx, 7
+				emit.bytes({0x88, 0x0a});					//mov byte [rdx], cl
+			}
+			else { //OUT, value = (A << 8) | (value >> 8)
+				emit.movRdx(&device->value);
+				emit.bytes({0x0f, 0xb6, 0x42, 0x01});		//movzx eax, byte [rdx + 1]
+				emit.load8(CL, fieldA);
+				emit.bytes({0xc1, 0xe1, 0x08});				//shl ecx, 8
+				emit.bytes({0x09, 0xc8});					//or eax, ecx
+				emit.bytes({0x66, 0x89, 0x02});				//mov word [rdx], ax
+			}
+		}
+		else if(op == 0xc3) { //JMP
+			emit.storeImm16(fieldPC, (imm2 << 8) | imm1);
+		}
+		else
+			native = false;
+
+#ifdef LAZY_FLAGS
+		//Native flag writes leave nothing pending
+		if(native && ((op >= 0x80 && op < 0xc0) || (op >= 0xc0 && (op & 0x07) == 0x06) || (op < 0x40 && ((op & 0x07) == 0x04 || (op & 0x07) == 0x05))))
+			emit.storeImm8(field(&this->lazyOp), LAZY_NONE);
+#endif
+
+		executed++;
+		if(native) {
+			inlineCycles += opcodes[op].cycles;
+			pcCurrent = (op == 0xc3);
+		}
+		else {
+			emit.storeImm16(fieldPC, address + 1);
+			emit.callHandler(opTable[op]);
+			pcCurrent = true;
+			if(mayWrite(op) && i + 1 < block->ops.size())
+				emit.exitIfInvalidated(fieldInvalidated, executed, inlineCycles);
+		}
+		address = next;
+		if(op == 0xc3)
+			break;
+	}
+
+	if(executed == 0)
+		return false;
+	if(!pcCurrent)
+		emit.storeImm16(fieldPC, address);
+	emit.epilogue(executed, inlineCycles, true);
+
+	block->native = (Block::NativeCode) this->jit->begin();
+	block->nativeOps = executed;
+	this->jit->commit(emit.size());
+	return true;
+}
+
+void MachineState::runJit(uint64_t count) {
+#ifdef HAVE_COMPUTED_GOTO
+	//decodeBlock stores runCached labels, which only exist once it has run
+	if(cachedLabels == nullptr)
+		this->runCached(0);
+#endif
+	if(this->blocks.empty())
+		this->blocks.resize(0x10000);
+	while(count > 0) {
+		this->retiredBlocks.clear();
+		Block* block = this->blocks[this->pc].get();
+		if(block == nullptr)
+			block = this->decodeBlock(this->pc);
+		if(block->native == nullptr && block->runs < JIT_THRESHOLD && ++block->runs == JIT_THRESHOLD)
+			this->compileBlock(block, this->pc);
+
+		this->blockInvalidated = false;
+		if(block->native != nullptr && block->nativeOps <= count)
+			count -= block->native(this);
+		else {
+			//Cold blocks, blocks starting with IN, OUT or HLT and the tail of a
+			//run go through the interpreter
+			uint64_t run = std::min<uint64_t>(count, block->ops.size());
+			for(uint64_t i = 0; i < run; ) {
+				opTable[this->memory[this->pc++]](*this);
+				if(++i < run && this->blockInvalidated)
+					run = i;
+			}
+			count -= run;
+		}
+	}
+}
+
+#endif
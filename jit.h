@@ -0,0 +1,24 @@
+#ifndef jit_h
+#define jit_h
+
+#include <cstddef>
+#include <cstdint>
+
+//Executable memory the x86-64 translator writes compiled blocks into
+class JitBuffer {
+public:
+	JitBuffer(size_t size);
+	~JitBuffer();
+
+	unsigned char* begin() const { return code + used; }
+	size_t available() const { return size - used; }
+	void commit(size_t bytes) { used += bytes; }
+	void clear() { used = 0; }
+
+private:
+	unsigned char* code;
+	size_t used;
+	size_t size;
+};
+
+#endif
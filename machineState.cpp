@@ -1,83 +1,192 @@
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "machineState.h"
+#include "fileReader.h"
+#include "jit.h"
+#include "shiftRegister.h"
 
-bool isascii(const std::string& fileName) {
-	//Thanks to https://stackoverflow.com/questions/277521/how-to-identify-the-file-content-as-ascii-or-binary
-	std::ifstream input;
-	input.open(fileName, std::ios::in);
-	if(!input) {
-		std::cerr << "File " << fileName << " not found" << std::endl;
-		exit(1);
-	}
-	int i;
-	while((i = input.get()) != EOF && i <= 127) {}
-	input.clear();
-	input.close();
-	return i == EOF;
-}
-
-int Parity(int num) {
-	uint8_t answer = 0;
-	while(num != 0) {
-		answer += (num & 1);
-		num = num >> 1;
+//A file is hex text if no byte has its top bit set. Four 16 byte loads are
+//OR'd and tested together, 64 bytes a step, stopping at the first step that
+//finds one.
+static bool isText(const uint8_t* data, size_t size) {
+	size_t i = 0;
+#if defined(__SSE2__)
+	for(; i + 64 <= size; i += 64) {
+		const __m128i* chunk = (const __m128i*)(data + i);
+		const __m128i bits = _mm_or_si128(_mm_or_si128(_mm_loadu_si128(chunk), _mm_loadu_si128(chunk + 1)),
+			_mm_or_si128(_mm_loadu_si128(chunk + 2), _mm_loadu_si128(chunk + 3)));
+		if(_mm_movemask_epi8(bits) != 0)
+			return false;
 	}
-	return !(answer & 1);
+#endif
+	uint8_t bits = 0;
+	for(; i < size; i++)
+		bits |= data[i];
+	return (bits & 0x80) == 0;
 }
 
-MachineState::MachineState(const std::string& fileName) {
+//Pairs hex digits into bytes, skipping whitespace. A digit left over at the
+//end is a byte of its own.
+static uint32_t parseHex(const uint8_t* text, size_t size, uint8_t* memory) {
+	uint32_t count = 0;
+	bool firstChar = true;
+	for(size_t i = 0; i < size; i++) {
+		if(std::isspace(text[i]))
+			continue;
+		//tempchar takes care of 0 in ascii != 0 in hex
+		uint8_t tempchar = text[i];
+		if(tempchar < 58) tempchar -= 48;
+		else tempchar -= 87;
 
-	std::ifstream input;
-
-	if(isascii(fileName)) {
-		std::vector<unsigned char> asciiConverter;
-		input.open(fileName, std::ios::in);
-		std::string tmp;
-		bool firstChar = true;
-		while(input >> tmp) {
-			for(unsigned int i = 0; i < tmp.size(); i++) {
-				//tempchar takes care of 0 in ascii != 0 in hex
-				uint8_t tempchar = tmp[i];
-				if(tempchar < 58) tempchar -= 48;
-				else tempchar -= 87;
-
-				if(firstChar) {
-					asciiConverter.push_back(tempchar);
-					firstChar = false;
-				}
-				else {
-					asciiConverter[asciiConverter.size()-1] = asciiConverter[asciiConverter.size()-1] << 4;
-					asciiConverter[asciiConverter.size()-1] += tempchar;
-					firstChar = true;
-				}
-			}
+		if(firstChar) {
+			if(count == 0x10000)
+				break;
+			memory[count++] = tempchar;
+			firstChar = false;
 		}
-		memorySize = asciiConverter.size();
-		memory = new unsigned char[memorySize];
-		for(unsigned int i = 0; i < memorySize; i++) {
-			memory[i] = asciiConverter[i];
+		else {
+			memory[count - 1] = (memory[count - 1] << 4) + tempchar;
+			firstChar = true;
 		}
+	}
+	return count;
+}
+
+//Zero, sign and parity flags for every possible 8 bit result
+static std::array<uint8_t, 256> buildSZP() {
+	std::array<uint8_t, 256> table;
+	for(int i = 0; i < 256; i++) {
+		int bits = 0;
+		for(int num = i; num != 0; num >>= 1)
+			bits += num & 1;
+		table[i] = (i == 0 ? FLAG_Z : 0) | (i & FLAG_S) | ((bits & 1) ? 0 : FLAG_P);
+	}
+	return table;
+}
+static const std::array<uint8_t, 256> szp = buildSZP();
+
+//With LAZY_FLAGS only the carry bit of f is kept up to date by arithmetic,
+//the other flags are rebuilt from the last recorded ALU result when read
+inline bool MachineState::flag(uint8_t mask) const {
+#ifdef LAZY_FLAGS
+	if(mask != FLAG_CY && this->lazyOp != LAZY_NONE)
+		return szp[this->lazyResult] & mask;
+#endif
+	return this->f & mask;
+}
+
+uint8_t MachineState::flags() const {
+#ifdef LAZY_FLAGS
+	switch(this->lazyOp) {
+		case LAZY_ADD:
+			return (this->f & FLAG_CY) | szp[this->lazyResult] | ((this->lazyLeft ^ this->lazyRight ^ this->lazyResult) & FLAG_AC);
+		case LAZY_LOGIC:
+			return (this->f & FLAG_CY) | szp[this->lazyResult] | ((this->lazyLeft & 0x08) << 1);
+		case LAZY_NONE:
+			break;
+	}
+#endif
+	return this->f;
+}
+
+void MachineState::setFlags(uint8_t value) {
+	this->f = value & FLAG_MASK;
+#ifdef LAZY_FLAGS
+	this->lazyOp = LAZY_NONE;
+#endif
+}
+
+//Plain RAM is a single load or store, any page with flags set goes through
+//readMapped or writeMapped
+inline uint8_t MachineState::readMemory(uint16_t address) {
+	if(this->pageFlags[address >> 8] & PAGE_DEVICE)
+		return this->pageDevice[address >> 8]->read(address);
+	return this->memory[address];
+}
+
+inline void MachineState::writeMemory(uint16_t address, uint8_t value) {
+	if(this->pageFlags[address >> 8])
+		this->writeMapped(address, value);
+	else
+		this->memory[address] = value;
+}
+
+//Z, S, P from result, AC from the carry out of bit 3 of left + right
+inline void MachineState::setAddFlags(uint8_t result, uint8_t left, uint8_t right, uint8_t carry) {
+#ifdef LAZY_FLAGS
+	this->f = carry;
+	this->lazyOp = LAZY_ADD;
+	this->lazyResult = result;
+	this->lazyLeft = left;
+	this->lazyRight = right;
+#else
+	this->f = szp[result] | carry | ((left ^ right ^ result) & FLAG_AC);
+#endif
+}
+
+//Z, S, P from result, AC from bit 3 of acBits, carry cleared
+inline void MachineState::setLogicFlags(uint8_t result, uint8_t acBits) {
+#ifdef LAZY_FLAGS
+	this->f = 0;
+	this->lazyOp = LAZY_LOGIC;
+	this->lazyResult = result;
+	this->lazyLeft = acBits;
+#else
+	this->f = szp[result] | ((acBits & 0x08) << 1);
+#endif
+}
+
+//Exits rather than run an image that was only partly read
+static void readFailed(const std::string& fileName) {
+	std::cerr << "Could not read " << fileName << std::endl;
+	exit(1);
+}
+
+MachineState::MachineState(const std::string& fileName) {
+	FileReader file(fileName);
+	if(!file.isOpen()) {
+		std::cerr << "File " << fileName << " not found" << std::endl;
+		exit(1);
+	}
+	const uint64_t size = file.size();
+	memory = new unsigned char[0x10000](); //Whole address space so stack and stores stay in bounds
+
+	//Binary files go where CP/M would load them, at 100, so the start of the
+	//file is read straight there and only the rest of a long one is read aside
+	//to finish classifying it. Hex text is the rare case and is read again.
+	const size_t loaded = std::min<uint64_t>(size, 0x10000 - 256);
+	if(!file.read(memory + 256, loaded, 0))
+		readFailed(fileName);
+	bool text = isText(memory + 256, loaded);
+	if(text && size > loaded) {
+		std::vector<uint8_t> rest(size - loaded);
+		if(!file.read(rest.data(), rest.size(), loaded))
+			readFailed(fileName);
+		text = isText(rest.data(), rest.size());
+	}
+
+	if(text) {
+		std::vector<uint8_t> hex(size);
+		if(!file.read(hex.data(), hex.size(), 0))
+			readFailed(fileName);
+		std::fill(memory, memory + 0x10000, 0);
+		memorySize = parseHex(hex.data(), hex.size(), memory);
 		this->pc = 0;
 	}
 	else {
-		input.open(fileName, std::ios::in | std::ios::binary | std::ios::ate);
-		memorySize = input.tellg();
-    	input.seekg (0, std::ios::beg);
-		char* memorySigned = new char[memorySize];
-		memory = new unsigned char[memorySize+256]; //For files where real code starts at 100
-    	input.read (memorySigned, memorySize);
-    	for(unsigned int i = 0; i < 256; i++) memory[i] = 0;
-    	for(unsigned int i = 0; i < memorySize; i++)
-    		memory[i+256] = (unsigned char) memorySigned[i];
-    	memorySize += 256;
-    	delete[] memorySigned;
-    	this->pc = 0x100;
+		memorySize = loaded + 256;
+		this->pc = 0x100;
 	}
-	input.close();
 
 	//establish initial values
 	this->sp = 0x3ff;
@@ -88,12 +197,268 @@ MachineState::MachineState(const std::string& fileName) {
 	this->e = 0;
 	this->h = 0;
 	this->l = 0;
+	this->int_enable = 0;
+	this->setFlags(0);
+	std::fill(this->inputPorts, this->inputPorts + 256, this->defaultPorts);
+	std::fill(this->outputPorts, this->outputPorts + 256, this->defaultPorts);
+}
+
+MachineState::MachineState(const std::vector<uint8_t>& image, uint16_t origin) {
+	memory = new unsigned char[0x10000]();
+	memorySize = std::min<size_t>(origin + image.size(), 0x10000);
+	for(unsigned int i = 0; i < image.size() && origin + i < 0x10000; i++)
+		memory[origin + i] = image[i];
+
+	this->pc = origin;
+	this->sp = 0x3ff;
+	this->a = 0;
+	this->b = 0;
+	this->c = 0;
+	this->d = 0;
+	this->e = 0;
+	this->h = 0;
+	this->l = 0;
+	this->int_enable = 0;
+	this->setFlags(0);
+	std::fill(this->inputPorts, this->inputPorts + 256, this->defaultPorts);
+	std::fill(this->outputPorts, this->outputPorts + 256, this->defaultPorts);
 }
 
 MachineState::~MachineState() {
 	delete[] memory;
 }
 
+//Exits on ranges the page table can't represent
+static void checkPageRange(uint16_t start, uint32_t size) {
+	if((start & 0xff) != 0 || (size & 0xff) != 0 || start + size > 0x10000) {
+		std::cerr << "Memory map ranges must be whole 256 byte pages inside 64K" << std::endl;
+		exit(1);
+	}
+}
+
+//Watches are installed by Video and the debugger, not by the memory map,
+//so remapping a page keeps them
+static const uint8_t PAGE_WATCHES = PAGE_WATCHED | PAGE_WATCHPOINT;
+
+void MachineState::mapPages(uint16_t start, uint32_t size, uint8_t flags) {
+	checkPageRange(start, size);
+	for(uint32_t page = start >> 8; page < (start + size) >> 8; page++) {
+		if(this->pageFlags[page] & PAGE_MIRROR) {
+			//Undo the mirroring from either end, mirrors of a remapped page keep their bytes as RAM
+			uint8_t target = this->pageTarget[page];
+			std::vector<uint8_t>& targetMirrors = this->mirrors[target];
+			if(target == page) {
+				for(uint8_t mirror : targetMirrors)
+					this->pageFlags[mirror] &= ~PAGE_MIRROR;
+				targetMirrors.clear();
+			}
+			else {
+				targetMirrors.erase(std::remove(targetMirrors.begin(), targetMirrors.end(), page), targetMirrors.end());
+				if(targetMirrors.empty())
+					this->pageFlags[target] &= ~PAGE_MIRROR;
+			}
+		}
+		if(this->pageFlags[page] & PAGE_DEVICE)
+			this->devicePages--;
+		if(flags & PAGE_DEVICE)
+			this->devicePages++;
+		this->pageFlags[page] = flags | (this->pageFlags[page] & PAGE_WATCHES);
+		this->pageDevice[page] = nullptr;
+	}
+	//Compiled blocks may have inlined loads from what used to be plain memory
+	this->flushBlocks();
+}
+
+void MachineState::mapRAM(uint16_t start, uint32_t size) {
+	this->mapPages(start, size, 0);
+}
+
+void MachineState::mapROM(uint16_t start, uint32_t size) {
+	this->mapPages(start, size, PAGE_ROM);
+}
+
+void MachineState::mapMirror(uint16_t start, uint32_t size, uint16_t target) {
+	this->mapPages(start, size, 0);
+	for(uint32_t offset = 0; offset < size; offset += 0x100) {
+		uint8_t page = (start + offset) >> 8;
+		uint8_t targetPage = (uint16_t) (target + offset) >> 8;
+		if(this->pageFlags[targetPage] & PAGE_MIRROR)
+			targetPage = this->pageTarget[targetPage];
+		if(this->pageFlags[targetPage] & PAGE_DEVICE) {
+			std::cerr << "Device pages can't be mirrored, map the device again instead" << std::endl;
+			exit(1);
+		}
+		if(targetPage == page)
+			continue;
+		this->pageFlags[page] = (this->pageFlags[targetPage] & PAGE_ROM) | PAGE_MIRROR | (this->pageFlags[page] & PAGE_WATCHES);
+		this->pageFlags[targetPage] |= PAGE_MIRROR;
+		this->pageTarget[page] = targetPage;
+		this->pageTarget[targetPage] = targetPage;
+		this->mirrors[targetPage].push_back(page);
+		std::copy(this->memory + (targetPage << 8), this->memory + (targetPage << 8) + 0x100, this->memory + (page << 8));
+	}
+}
+
+void MachineState::mapDevice(uint16_t start, uint32_t size, MemoryDevice* device) {
+	this->mapPages(start, size, PAGE_DEVICE);
+	for(uint32_t page = start >> 8; page < (start + size) >> 8; page++)
+		this->pageDevice[page] = device;
+}
+
+void MachineState::watchWrites(uint16_t start, uint32_t size, bool enabled) {
+	checkPageRange(start, size);
+	for(uint32_t page = start >> 8; page < (start + size) >> 8; page++) {
+		if(enabled)
+			this->pageFlags[page] |= PAGE_WATCHED;
+		else
+			this->pageFlags[page] &= ~PAGE_WATCHED;
+	}
+}
+
+void MachineState::setWatchpoint(int address) {
+	if(this->watchpoint >= 0)
+		this->pageFlags[this->watchpoint >> 8] &= ~PAGE_WATCHPOINT;
+	this->watchpoint = address >= 0 ? address & 0xffff : -1;
+	if(this->watchpoint >= 0)
+		this->pageFlags[this->watchpoint >> 8] |= PAGE_WATCHPOINT;
+}
+
+MachineState::Snapshot MachineState::snapshot() {
+	Snapshot saved;
+	for(unsigned int page = 0; page < 256; page++) {
+		if(this->pageFlags[page] & PAGE_DEVICE)
+			continue;
+		if(!(this->pageFlags[page] & PAGE_SHARED)) {
+			std::shared_ptr<Page> copy = std::make_shared<Page>();
+			std::copy(this->memory + (page << 8), this->memory + (page << 8) + 0x100, copy->begin());
+			this->basePages[page] = std::move(copy);
+			this->pageFlags[page] |= PAGE_SHARED;
+		}
+		saved.pages[page] = this->basePages[page];
+	}
+	saved.psw = (this->a << 8) | this->flags();
+	saved.bc = this->bc;
+	saved.de = this->de;
+	saved.hl = this->hl;
+	saved.sp = this->sp;
+	saved.pc = this->pc;
+	saved.intEnable = this->int_enable;
+	saved.halted = this->halted;
+	saved.cycles = this->cycles;
+	saved.memorySize = this->memorySize;
+	saved.events = this->events;
+	if(this->shiftRegister != nullptr) {
+		saved.shiftValue = this->shiftRegister->value;
+		saved.shiftOffset = this->shiftRegister->offset;
+	}
+	return saved;
+}
+
+void MachineState::restore(const Snapshot& saved) {
+	for(unsigned int page = 0; page < 256; page++) {
+		uint8_t flags = this->pageFlags[page];
+		if((flags & PAGE_DEVICE) || saved.pages[page] == nullptr)
+			continue;
+		//Pages still shared with the snapshot already hold its bytes
+		if(!(flags & PAGE_SHARED) || this->basePages[page] != saved.pages[page]) {
+			std::copy(saved.pages[page]->begin(), saved.pages[page]->end(), this->memory + (page << 8));
+			this->pageReplaced(page);
+			this->basePages[page] = saved.pages[page];
+		}
+		this->pageFlags[page] |= PAGE_SHARED;
+	}
+	this->a = saved.psw >> 8;
+	this->setFlags(saved.psw & 0xff);
+	this->bc = saved.bc;
+	this->de = saved.de;
+	this->hl = saved.hl;
+	this->sp = saved.sp;
+	this->pc = saved.pc;
+	this->int_enable = saved.intEnable;
+	this->halted = saved.halted;
+	this->cycles = saved.cycles;
+	this->memorySize = saved.memorySize;
+	this->events = saved.events;
+	if(this->shiftRegister != nullptr) {
+		this->shiftRegister->value = saved.shiftValue;
+		this->shiftRegister->offset = saved.shiftOffset;
+	}
+}
+
+//After the bytes of a whole page were swapped for others behind the back of
+//storeTracked, does what its stores would have
+void MachineState::pageReplaced(uint8_t page) {
+	const uint8_t flags = this->pageFlags[page];
+	this->pageFlags[page] = flags & ~PAGE_SHARED;
+	if(flags & PAGE_CODE)
+		this->invalidatePage(page);
+	if(flags & PAGE_WATCHED) {
+		for(unsigned int line = 0; line < 0x100; line += DIRTY_LINE_SIZE)
+			this->lineWrites[((page << 8) + line) / DIRTY_LINE_SIZE] = ++this->writeCount;
+	}
+}
+
+void MachineState::mapInputPort(uint8_t port, PortDevice* device) {
+	this->inputPorts[port] = device != nullptr ? device : this->defaultPorts;
+	this->flushBlocks(); //Compiled code can have the old device inlined
+}
+
+void MachineState::mapOutputPort(uint8_t port, PortDevice* device) {
+	this->outputPorts[port] = device != nullptr ? device : this->defaultPorts;
+	this->flushBlocks(); //Compiled code can have the old device inlined
+}
+
+void MachineState::setDefaultPorts(PortDevice* device) {
+	PortDevice* old = this->defaultPorts;
+	this->defaultPorts = device != nullptr ? device : &this->noPorts;
+	std::replace(this->inputPorts, this->inputPorts + 256, old, this->defaultPorts);
+	std::replace(this->outputPorts, this->outputPorts + 256, old, this->defaultPorts);
+	this->flushBlocks();
+}
+
+void MachineState::mapShiftRegister(ShiftRegister* device) {
+	this->mapOutputPort(device->offsetPort, device);
+	this->mapInputPort(device->resultPort, device);
+	this->mapOutputPort(device->dataPort, device);
+	this->shiftRegister = device;
+}
+
+void MachineState::writeMapped(uint16_t address, uint8_t value) {
+	uint8_t page = address >> 8;
+	uint8_t flags = this->pageFlags[page];
+	if(flags & PAGE_ROM)
+		return;
+	if(flags & PAGE_DEVICE) {
+		this->pageDevice[page]->write(address, value);
+		return;
+	}
+	if(flags & PAGE_MIRROR) {
+		//Mirrors keep their own copy of the bytes so loads stay a plain index
+		uint8_t target = this->pageTarget[page];
+		this->storeTracked((target << 8) | (address & 0xff), value);
+		for(uint8_t mirror : this->mirrors[target])
+			this->storeTracked((mirror << 8) | (address & 0xff), value);
+		return;
+	}
+	this->storeTracked(address, value);
+}
+
+//Store that still drops any cached blocks covering the address, marks
+//watched lines, counts watchpoint hits and unshares the page from the last
+//snapshot
+void MachineState::storeTracked(uint16_t address, uint8_t value) {
+	this->memory[address] = value;
+	uint8_t flags = this->pageFlags[address >> 8];
+	if(flags & PAGE_SHARED)
+		this->pageFlags[address >> 8] = flags & ~PAGE_SHARED; //The next snapshot copies it
+	if(flags & PAGE_WATCHED)
+		this->lineWrites[address / DIRTY_LINE_SIZE] = ++this->writeCount;
+	if((flags & PAGE_WATCHPOINT) && address == this->watchpoint)
+		this->watchpointStores++;
+	if(flags & PAGE_CODE)
+		this->invalidateCode(address);
+}
+
 void MachineState::printState() const {
 	std::cout << "pc,sp: " << std::hex << std::setw(4) << std::setfill('0') << +this->pc << "," << +this->sp << "\n";
 	std::cout << "a\tb c\td e\th l\n";
@@ -104,8 +469,10 @@ void MachineState::printState() const {
 	std::cout << std::setw(2) << std::setfill('0') << (int) this->e << "\t";
 	std::cout << std::setw(2) << std::setfill('0') << (int) this->h;
 	std::cout << std::setw(2) << std::setfill('0') << (int) this->l << "\n";
-	std::cout << "z,s,p,cy,ac: " << +this->cc[0] << "," << +this->cc[1] << "," << +this->cc[2] << ","
-								<< +this->cc[3] << "," << +this->cc[4] << "\n";
+	uint8_t flags = this->flags();
+	std::cout << "z,s,p,cy,ac: " << !!(flags & FLAG_Z) << "," << !!(flags & FLAG_S) << "," << !!(flags & FLAG_P) << ","
+								<< !!(flags & FLAG_CY) << "," << !!(flags & FLAG_AC) << "\n";
+	std::cout << "cycles: " << std::dec << this->cycles << std::hex << "\n";
 	std::cout << "Next Instruction: ";
 	this->getOpcode(this->pc);
 	std::cout << "                  ";
@@ -114,795 +481,1015 @@ void MachineState::printState() const {
 }
 
 void MachineState::printDisassembled() const {
-	for(uint16_t i = 0; i < memorySize; ) {
+	for(uint32_t i = 0; i < memorySize; ) {
 		i += this->getOpcode(i);
 	}
 }
 
-void MachineState::processCommand() {
+template<> inline void MachineState::exec<0x00>() {} //NOP
+
+template<> inline void MachineState::exec<0x01>() { //LXI    B,word
+	this->c = this->memory[this->pc];
+	this->b = this->memory[(uint16_t) (this->pc+1)];
+	this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0x02>() { //STAX   B
+	this->writeMemory(this->bc, this->a);
+}
+
+template<> inline void MachineState::exec<0x03>() { //INX    B
+	this->bc++;
+}
+
+template<> inline void MachineState::exec<0x04>() { //INR    B
+	this->b = inr(this->b);
+}
+
+template<> inline void MachineState::exec<0x05>() { //DCR    B
+	this->b = dcr(this->b);
+}
+
+template<> inline void MachineState::exec<0x06>() { //MVI    B
+	this->b = this->memory[this->pc];
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0x07>() { //RLC
+	this->a = (this->a<<1) | (this->a>>7);
+	this->f = (this->f & ~FLAG_CY) | (this->a & FLAG_CY);
+}
+
+template<> inline void MachineState::exec<0x08>() {} //NOP
+
+template<> inline void MachineState::exec<0x09>() { //DAD    B
+	dad(this->bc);
+}
+
+template<> inline void MachineState::exec<0x0a>() { //LDAX   B
+	this->a = this->readMemory(this->bc);
+}
+
+template<> inline void MachineState::exec<0x0b>() { //DCX    B
+	this->bc--;
+}
+
+template<> inline void MachineState::exec<0x0c>() { //INR    C
+	this->c = inr(this->c);
+}
+
+template<> inline void MachineState::exec<0x0d>() { //DCR    C
+	this->c = dcr(this->c);
+}
+
+template<> inline void MachineState::exec<0x0e>() { //MVI    C
+	this->c = this->memory[this->pc];
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0x0f>() { //RRC
+	this->a = (this->a>>1) | (this->a<<7);
+	this->f = (this->f & ~FLAG_CY) | (this->a>>7);
+}
+
+template<> inline void MachineState::exec<0x10>() {} //NOP
+
+template<> inline void MachineState::exec<0x11>() { //LXI    D,word
+	this->e = this->memory[this->pc];
+	this->d = this->memory[(uint16_t) (this->pc+1)];
+	this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0x12>() { //STAX   D
+	this->writeMemory(this->de, this->a);
+}
+
+template<> inline void MachineState::exec<0x13>() { //INX    D
+	this->de++;
+}
+
+template<> inline void MachineState::exec<0x14>() { //INR    D
+	this->d = inr(this->d);
+}
+
+template<> inline void MachineState::exec<0x15>() { //DCR    D
+	this->d = dcr(this->d);
+}
+
+template<> inline void MachineState::exec<0x16>() { //MVI    D
+	this->d = this->memory[this->pc];
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0x17>() { //RAL
+	uint8_t temp8 = this->f & FLAG_CY;
+	this->f = (this->f & ~FLAG_CY) | (this->a>>7);
+	this->a = (this->a<<1) | temp8;
+}
+
+template<> inline void MachineState::exec<0x18>() {} //NOP
+
+template<> inline void MachineState::exec<0x19>() { //DAD    D
+	dad(this->de);
+}
+
+template<> inline void MachineState::exec<0x1a>() { //LDAX   D
+	this->a = this->readMemory(this->de);
+}
+
+template<> inline void MachineState::exec<0x1b>() { //DCX    D
+	this->de--;
+}
+
+template<> inline void MachineState::exec<0x1c>() { //INR    E
+	this->e = inr(this->e);
+}
+
+template<> inline void MachineState::exec<0x1d>() { //DCR    E
+	this->e = dcr(this->e);
+}
+
+template<> inline void MachineState::exec<0x1e>() { //MVI    E
+	this->e = this->memory[this->pc];
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0x1f>() { //RAR
+	uint8_t temp8 = this->f & FLAG_CY;
+	this->f = (this->f & ~FLAG_CY) | (this->a & 0x01);
+	this->a = (this->a>>1) | (temp8<<7);
+}
+
+template<> inline void MachineState::exec<0x20>() {} //NOP
+
+template<> inline void MachineState::exec<0x21>() { //LXI    H,word
+	this->l = this->memory[this->pc];
+	this->h = this->memory[(uint16_t) (this->pc+1)];
+	this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0x22>() { //SHLD
+	uint16_t temp16 = (this->memory[(uint16_t) (this->pc+1)]<<8) | this->memory[this->pc];
+	this->writeMemory(temp16, this->l);
+	this->writeMemory(temp16+1, this->h);
+	this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0x23>() { //INX    H
+	this->hl++;
+}
+
+template<> inline void MachineState::exec<0x24>() { //INR    H
+	this->h = inr(this->h);
+}
+
+template<> inline void MachineState::exec<0x25>() { //DCR    H
+	this->h = dcr(this->h);
+}
+
+template<> inline void MachineState::exec<0x26>() { //MVI    H
+	this->h = this->memory[this->pc];
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0x27>() { //DAA
 	uint8_t temp8;
-	uint16_t temp16;
-	switch(this->memory[this->pc]) {
-		case 0x00: //NOP
-			break;
-		case 0x01: //LXI    B,word
-			this->c = this->memory[this->pc+1];
-			this->b = this->memory[this->pc+2];
-			this->pc += 2; break;
-		case 0x02: //STAX   B
-			this->memory[(this->b<<8) | (this->c)] = this->a; break;
-		case 0x03: //INX    B
-			temp16 = (this->b<<8) | (this->c);
-			temp16++;
-			this->b = temp16 >> 8;
-			this->c = temp16 & 0xff; break;
-		case 0x04: //INR    B
-			this->cc[4] = ((this->b & 0x0f) + 1) > 0x0f;
-			this->b++;
-			this->cc[0] = ((this->b & 0xff) == 0);
-			this->cc[1] = ((this->b & 0x80) != 0);
-			this->cc[2] = Parity(this->b); break;
-		case 0x05: //DCR    B
-			this->cc[4] = ((this->b & 0x0f) + 0x0f) > 0x0f;
-			this->b--;
-			this->cc[0] = ((this->b & 0xff) == 0);
-			this->cc[1] = ((this->b & 0x80) != 0);
-			this->cc[2] = Parity(this->b); break;
-		case 0x06: //MVI    B
-			this->b = this->memory[this->pc+1];
-			this->pc++; break;
-		case 0x07: //RLC
-			this->cc[3] = (this->a & 0x80) >> 7;
-			this->a = (this->a<<1) | this->cc[3]; break;
-		case 0x08: //NOP
-			break;
-		case 0x09: //DAD    B
-			dad((this->b<<8)|this->c); break;
-		case 0x0a: //LDAX   B
-			this->a = this->memory[(this->b<<8) | (this->c)]; break;
-		case 0x0b: //DCX    B
-			temp16 = (this->b<<8) | this->c;
-			temp16--;
-			this->b = temp16>>8;
-			this->c = temp16&0xff; break;
-		case 0x0c: //INR    C
-			this->cc[4] = ((this->c & 0x0f) + 1) > 0x0f;
-			this->c++;
-			this->cc[0] = ((this->c & 0xff) == 0);
-			this->cc[1] = ((this->c & 0x80) != 0);
-			this->cc[2] = Parity(this->c); break;
-		case 0x0d: //DCR    C
-			this->cc[4] = ((this->c & 0x0f) + 0x0f) > 0x0f;
-			this->c--;
-			this->cc[0] = ((this->c & 0xff) == 0);
-			this->cc[1] = ((this->c & 0x80) != 0);
-			this->cc[2] = Parity(this->c); break;
-		case 0x0e: //MVI    C
-			this->c = this->memory[this->pc+1];
-			this->pc++; break;
-		case 0x0f: //RRC
-			this->cc[3] = this->a & 0x01;
-			this->a = (this->a>>1) | (this->cc[3]<<7); break;
-		case 0x10: //NOP
-			break;
-		case 0x11: //LXI    D,word
-			this->e = this->memory[this->pc+1];
-			this->d = this->memory[this->pc+2];
-			this->pc += 2; break;
-		case 0x12:  //STAX   D
-			this->memory[(this->d<<8) | (this->e)] = this->a; break;
-		case 0x13: //INX    D
-			temp16 = (this->d<<8) | (this->e);
-			temp16++;
-			this->d = temp16 >> 8;
-			this->e = temp16 & 0xff; break;
-		case 0x14: //INR    D
-			this->cc[4] = ((this->d & 0x0f) + 1) > 0x0f;
-			this->d++;
-			this->cc[0] = ((this->d & 0xff) == 0);
-			this->cc[1] = ((this->d & 0x80) != 0);
-			this->cc[2] = Parity(this->d); break;
-		case 0x15: //DCR    D
-			this->cc[4] = ((this->d & 0x0f) + 0x0f) > 0x0f;
-			this->d--;
-			this->cc[0] = ((this->d & 0xff) == 0);
-			this->cc[1] = ((this->d & 0x80) != 0);
-			this->cc[2] = Parity(this->d); break;
-		case 0x16: //MVI    D
-			this->d = this->memory[this->pc+1];
-			this->pc++; break;
-		case 0x17: //RAL
-			temp8 = this->cc[3];
-			this->cc[3] = (this->a & 0x80) >> 7;
-			this->a = (this->a<<1) | temp8; break;
-		case 0x18: //NOP
-			break;
-		case 0x19: //DAD    D
-			dad((this->d<<8)|this->e); break;
-		case 0x1a: //LDAX   D
-			this->a = this->memory[(this->d<<8) | (this->e)]; break;
-		case 0x1b: //DCX    D
-			temp16 = (this->d<<8) | this->e;
-			temp16--;
-			this->d = temp16>>8;
-			this->e = temp16&0xff; break;
-		case 0x1c: //INR    E
-			this->cc[4] = ((this->e & 0x0f) + 1) > 0x0f;
-			this->e++;
-			this->cc[0] = ((this->e & 0xff) == 0);
-			this->cc[1] = ((this->e & 0x80) != 0);
-			this->cc[2] = Parity(this->e); break;
-		case 0x1d: //DCR    E
-			this->cc[4] = ((this->e & 0x0f) + 0x0f) > 0x0f;
-			this->e--;
-			this->cc[0] = ((this->e & 0xff) == 0);
-			this->cc[1] = ((this->e & 0x80) != 0);
-			this->cc[2] = Parity(this->e); break;
-		case 0x1e: //MVI    E
-			this->e = this->memory[this->pc+1];
-			this->pc++; break;
-		case 0x1f: //RAR
-			temp8 = this->cc[3];
-			this->cc[3] = this->a & 0x01;
-			this->a = (this->a>>1) | (temp8<<7); break;
-		case 0x20: //NOP
-			break;
-		case 0x21: //LXI    H,word
-			this->l = this->memory[this->pc+1];
-			this->h = this->memory[this->pc+2];
-			this->pc += 2; break;
-		case 0x22: //SHLD
-			temp16 = (this->memory[this->pc+2]<<8) | this->memory[this->pc+1];
-			this->memory[temp16] = this->l;
-			this->memory[temp16+1] = this->h;
-			this->pc += 2; break;
-		case 0x23: //INX    H
-			temp16 = (this->h<<8) | (this->l);
-			temp16++;
-			this->h = temp16 >> 8;
-			this->l = temp16 & 0xff; break;
-		case 0x24: //INR    H
-			this->cc[4] = ((this->h & 0x0f) + 1) > 0x0f;
-			this->h++;
-			this->cc[0] = ((this->h & 0xff) == 0);
-			this->cc[1] = ((this->h & 0x80) != 0);
-			this->cc[2] = Parity(this->h); break;
-		case 0x25: //DCR    H
-			this->cc[4] = ((this->h & 0x0f) + 0x0f) > 0x0f;
-			this->h--;
-			this->cc[0] = ((this->h & 0xff) == 0);
-			this->cc[1] = ((this->h & 0x80) != 0);
-			this->cc[2] = Parity(this->h); break;
-		case 0x26: //MVI    H
-			this->h = this->memory[this->pc+1];
-			this->pc++; break;
-		case 0x27: //DAA
-			if(this->cc[4] || ((this->a & 0x0f) > 9)) {
-				temp8 = (this->a & 0x0f) + 6;
-				this->cc[4] = (temp8 > 0x0f);
-				this->a += 6;
-			}
-			if(this->cc[3] || (this->a>>4) > 9) {
-				temp8 = (this->a>>4) + 6;
-				this->cc[3] = (temp8 > 0x0f);
-				this->a = (this->a&0x0f) | (temp8<<4);
-			}
-			this->cc[0] = ((this->a & 0xff) == 0);
-			this->cc[1] = ((this->a & 0x80) != 0);
-			this->cc[2] = Parity(this->a); break;
-		case 0x28: //NOP
-			break;
-		case 0x29: //DAD    H
-			dad((this->h<<8)|this->l); break;
-		case 0x2a: //LHLD
-			temp16 = (this->memory[this->pc+2]<<8) | this->memory[this->pc+1];
-			this->l = this->memory[temp16];
-			this->h = this->memory[temp16+1];
-			this->pc += 2; break;
-		case 0x2b: //DCX    H
-			temp16 = (this->h<<8) | this->l;
-			temp16--;
-			this->h = temp16>>8;
-			this->l = temp16&0xff; break;
-		case 0x2c:  //INR    L
-			this->cc[4] = ((this->l & 0x0f) + 1) > 0x0f;
-			this->l++;
-			this->cc[0] = ((this->l & 0xff) == 0);
-			this->cc[1] = ((this->l & 0x80) != 0);
-			this->cc[2] = Parity(this->l); break;
-		case 0x2d: //DCR    L
-			this->cc[4] = ((this->l & 0x0f) + 0x0f) > 0x0f;
-			this->l--;
-			this->cc[0] = ((this->l & 0xff) == 0);
-			this->cc[1] = ((this->l & 0x80) != 0);
-			this->cc[2] = Parity(this->l); break;
-		case 0x2e: //MVI    L
-			this->l = this->memory[this->pc+1];
-			this->pc++; break;
-		case 0x2f: //CMA
-			this->a = ~this->a; break;
-		case 0x30: //NOP
-			break;
-		case 0x31: //LXI    SP,word
-			this->sp = (this->memory[this->pc+2]<<8) | this->memory[this->pc+1];
-			this->pc += 2; break;
-		case 0x32: //STA
-			this->memory[this->memory[this->pc+2]<<8 | this->memory[this->pc+1]] = this->a;
-			this->pc += 2; break;
-		case 0x33:  //INX    SP
-			this->sp++; break;
-		case 0x34:  //INR    M
-			this->cc[4] = ((this->memory[(this->h<<8) | (this->l)] & 0x0f) + 1) > 0x0f;
-			this->memory[(this->h<<8) | (this->l)]++;
-			this->cc[0] = ((this->memory[(this->h<<8) | (this->l)] & 0xff) == 0);
-			this->cc[1] = ((this->memory[(this->h<<8) | (this->l)] & 0x80) != 0);
-			this->cc[2] = Parity(this->memory[(this->h<<8) | (this->l)]); break;
-		case 0x35: //DCR    M
-			this->cc[4] = ((this->memory[(this->h<<8) | (this->l)] & 0x0f) + 0x0f) > 0x0f;
-			this->memory[(this->h<<8) | (this->l)]--;
-			this->cc[0] = ((this->memory[(this->h<<8) | (this->l)] & 0xff) == 0);
-			this->cc[1] = ((this->memory[(this->h<<8) | (this->l)] & 0x80) != 0);
-			this->cc[2] = Parity(this->memory[(this->h<<8) | (this->l)]); break;
-		case 0x36: //MVI    M
-			this->memory[(this->h<<8) | (this->l)] = this->memory[this->pc+1];
-			this->pc++; break;
-		case 0x37: //STC
-			this->cc[3] = 1; break;
-		case 0x38: //NOP
-			break;
-		case 0x39: //DAD    SP
-			dad(this->sp); break;
-		case 0x3a: //LDA
-			this->a = this->memory[this->memory[this->pc+2]<<8 | this->memory[this->pc+1]];
-			this->pc += 2; break;
-		case 0x3b: //DCX    SP
-			this->sp--; break;
-		case 0x3c: //INR    A
-			this->cc[4] = ((this->a & 0x0f) + 1) > 0x0f;
-			this->a++;
-			this->cc[0] = ((this->a & 0xff) == 0);
-			this->cc[1] = ((this->a & 0x80) != 0);
-			this->cc[2] = Parity(this->a); break;
-		case 0x3d: //DCR    A
-			this->cc[4] = ((this->a & 0x0f) + 0x0f) > 0x0f;
-			this->a--;
-			this->cc[0] = ((this->a & 0xff) == 0);
-			this->cc[1] = ((this->a & 0x80) != 0);
-			this->cc[2] = Parity(this->a); break;
-		case 0x3e: //MVI    A
-			this->a = this->memory[this->pc+1];
-			this->pc++; break;
-		case 0x3f: //CMC
-			this->cc[3] = !this->cc[3]; break;
-		case 0x40: //MOV    B,B
-			this->b = this->b; break;
-		case 0x41: //MOV    B,C
-			this->b = this->c; break;
-		case 0x42: //MOV    B,D
-			this->b = this->d; break;
-		case 0x43: //MOV    B,E
-			this->b = this->e; break;
-		case 0x44: //MOV    B,H
-			this->b = this->h; break;
-		case 0x45: //MOV    B,L
-			this->b = this->l; break;
-		case 0x46: //MOV    B,M
-			this->b = this->memory[(this->h<<8) | (this->l)]; break;
-		case 0x47: //MOV    B,A
-			this->b = this->a; break;
-		case 0x48: //MOV    C,B
-			this->c = this->b; break;
-		case 0x49: //MOV    C,C
-			this->c = this->c; break;
-		case 0x4a: //MOV    C,D
-			this->c = this->d; break;
-		case 0x4b: //MOV    C,E
-			this->c = this->e; break;
-		case 0x4c: //MOV    C,H
-			this->c = this->h; break;
-		case 0x4d: //MOV    C,L
-			this->c = this->l; break;
-		case 0x4e: //MOV    C,M
-			this->c = this->memory[(this->h<<8) | (this->l)]; break;
-		case 0x4f: //MOV    C,A
-			this->c = this->a; break;
-		case 0x50: //MOV    D,B
-			this->d = this->b; break;
-		case 0x51: //MOV    D,C
-			this->d = this->c; break;
-		case 0x52: //MOV    D,D
-			this->d = this->d; break;
-		case 0x53: //MOV    D,E
-			this->d = this->e; break;
-		case 0x54: //MOV    D,H
-			this->d = this->h; break;
-		case 0x55: //MOV    D,L
-			this->d = this->l; break;
-		case 0x56: //MOV    D,M
-			this->d = this->memory[(this->h<<8) | (this->l)]; break;
-		case 0x57: //MOV    D,A
-			this->d = this->a; break;
-		case 0x58: //MOV    E,B
-			this->e = this->b; break;
-		case 0x59: //MOV    E,C
-			this->e = this->c; break;
-		case 0x5a: //MOV    E,D
-			this->e = this->d; break;
-		case 0x5b: //MOV    E,E
-			this->e = this->e; break;
-		case 0x5c: //MOV    E,H
-			this->e = this->h; break;
-		case 0x5d: //MOV    E,L
-			this->e = this->l; break;
-		case 0x5e: //MOV    E,M
-			this->e = this->memory[(this->h<<8) | (this->l)]; break;
-		case 0x5f: //MOV    E,A
-			this->e = this->a; break;
-		case 0x60: //MOV    H,B
-			this->h = this->b; break;
-		case 0x61: //MOV    H,C
-			this->h = this->c; break;
-		case 0x62: //MOV    H,D
-			this->h = this->d; break;
-		case 0x63: //MOV    H,E
-			this->h = this->e; break;
-		case 0x64: //MOV    H,H
-			this->h = this->h; break;
-		case 0x65: //MOV    H,L
-			this->h = this->l; break;
-		case 0x66: //MOV    H,M
-			this->h = this->memory[(this->h<<8) | (this->l)]; break;
-		case 0x67: //MOV    H,A
-			this->h = this->a; break;
-		case 0x68: //MOV    L,B
-			this->l = this->b; break;
-		case 0x69: //MOV    L,C
-			this->l = this->c; break;
-		case 0x6a: //MOV    L,D
-			this->l = this->d; break;
-		case 0x6b: //MOV    L,E
-			this->l = this->e; break;
-		case 0x6c: //MOV    L,H
-			this->l = this->h; break;
-		case 0x6d: //MOV    L,L
-			this->l = this->l; break;
-		case 0x6e: //MOV    L,M
-			this->l = this->memory[(this->h<<8) | (this->l)]; break;
-		case 0x6f: //MOV    L,A
-			this->l = this->a; break;
-		case 0x70: //MOV    M,B
-			this->memory[(this->h<<8) | (this->l)] = this->b; break;
-		case 0x71: //MOV    M,C
-			this->memory[(this->h<<8) | (this->l)] = this->c; break;
-		case 0x72: //MOV    M,D
-			this->memory[(this->h<<8) | (this->l)] = this->d; break;
-		case 0x73: //MOV    M,E
-			this->memory[(this->h<<8) | (this->l)] = this->e; break;
-		case 0x74: //MOV    M,H
-			this->memory[(this->h<<8) | (this->l)] = this->h; break;
-		case 0x75: //MOV    M,L
-			this->memory[(this->h<<8) | (this->l)] = this->l; break;
-		case 0x76: //HLT
-			exit(0); break;
-		case 0x77: //MOV    M,A
-			this->memory[(this->h<<8) | (this->l)] = this->a; break;
-		case 0x78: //MOV    A,B
-			this->a = this->b; break;
-		case 0x79: //MOV    A,C
-			this->a = this->c; break;
-		case 0x7a: //MOV    A,D
-			this->a = this->d; break;
-		case 0x7b: //MOV    A,E
-			this->a = this->e; break;
-		case 0x7c: //MOV    A,H
-			this->a = this->h; break;
-		case 0x7d: //MOV    A,L
-			this->a = this->l; break;
-		case 0x7e: //MOV    A,M
-			this->a = this->memory[(this->h<<8) | (this->l)]; break;
-		case 0x7f: //MOV    A,A
-			this->a = this->a; break;
-		case 0x80: //ADD    B
-			add(this->b, 0); break;
-		case 0x81: //ADD    C
-			add(this->c, 0); break;
-		case 0x82: //ADD    D
-			add(this->d, 0); break;
-		case 0x83: //ADD    E
-			add(this->e, 0); break;
-		case 0x84: //ADD    H
-			add(this->h, 0); break;
-		case 0x85: //ADD    L
-			add(this->l, 0); break;
-		case 0x86: //ADD    M
-			add(this->memory[(this->h<<8) | (this->l)], 0); break;
-		case 0x87: //ADD    A
-			add(this->a, 0); break;
-		case 0x88: //ADC    B
-			add(this->b, this->cc[3]); break;
-		case 0x89: //ADC    C
-			add(this->c, this->cc[3]); break;
-		case 0x8a: //ADC    D
-			add(this->d, this->cc[3]); break;
-		case 0x8b: //ADC    E
-			add(this->e, this->cc[3]); break;
-		case 0x8c: //ADC    H
-			add(this->h, this->cc[3]); break;
-		case 0x8d: //ADC    L
-			add(this->l, this->cc[3]); break;
-		case 0x8e: //ADC    M
-			add(this->memory[(this->h<<8) | (this->l)], this->cc[3]); break;
-		case 0x8f: //ADC    A
-			add(this->a, this->cc[3]); break;
-		case 0x90: //SUB    B
-			sub(this->b, 0); break;
-		case 0x91: //SUB    C
-			sub(this->c, 0); break;
-		case 0x92: //SUB    D
-			sub(this->d, 0); break;
-		case 0x93: //SUB    E
-			sub(this->e, 0); break;
-		case 0x94: //SUB    H
-			sub(this->h, 0); break;
-		case 0x95: //SUB    L
-			sub(this->l, 0); break;
-		case 0x96: //SUB    M
-			sub(this->memory[(this->h<<8) | (this->l)], 0); break;
-		case 0x97: //SUB    A
-			sub(this->a, 0); break;
-		case 0x98: //SBB    B
-			sub(this->b, this->cc[3]); break;
-		case 0x99: //SBB    C
-			sub(this->c, this->cc[3]); break;
-		case 0x9a: //SBB    D
-			sub(this->d, this->cc[3]); break;
-		case 0x9b: //SBB    E
-			sub(this->e, this->cc[3]); break;
-		case 0x9c: //SBB    H
-			sub(this->h, this->cc[3]); break;
-		case 0x9d: //SBB    L
-			sub(this->l, this->cc[3]); break;
-		case 0x9e: //SBB    M
-			sub(this->memory[(this->h<<8) | (this->l)], this->cc[3]); break;
-		case 0x9f: //SBB    A
-			sub(this->a, this->cc[3]); break;
-		case 0xa0: //ANA    B
-			ana(this->b); break;
-		case 0xa1: //ANA    C
-			ana(this->c); break;
-		case 0xa2: //ANA    D
-			ana(this->d); break;
-		case 0xa3: //ANA    E
-			ana(this->e); break;
-		case 0xa4: //ANA    H
-			ana(this->h); break;
-		case 0xa5: //ANA    L
-			ana(this->l); break;
-		case 0xa6: //ANA    M
-			ana(this->memory[(this->h<<8) | (this->l)]); break;
-		case 0xa7: //ANA    A
-			ana(this->a); break;
-		case 0xa8: //XRA    B
-			xra(this->b); break;
-		case 0xa9: //XRA    C
-			xra(this->c); break;
-		case 0xaa: //XRA    D
-			xra(this->d); break;
-		case 0xab: //XRA    E
-			xra(this->e); break;
-		case 0xac: //XRA    H
-			xra(this->h); break;
-		case 0xad: //XRA    L
-			xra(this->l); break;
-		case 0xae: //XRA    M
-			xra(this->memory[(this->h<<8) | (this->l)]); break;
-		case 0xaf: //XRA    A
-			xra(this->a); break;
-		case 0xb0: //ORA    B
-			ora(this->b); break;
-		case 0xb1: //ORA    C
-			ora(this->c); break;
-		case 0xb2: //ORA    D
-			ora(this->d); break;
-		case 0xb3: //ORA    E
-			ora(this->e); break;
-		case 0xb4: //ORA    H
-			ora(this->h); break;
-		case 0xb5: //ORA    L
-			ora(this->l); break;
-		case 0xb6: //ORA    M
-			ora(this->memory[(this->h<<8) | (this->l)]); break;
-		case 0xb7: //ORA    A
-			ora(this->a); break;
-		case 0xb8: //CMP    B
-			cmp(this->b); break;
-		case 0xb9: //CMP    C
-			cmp(this->c); break;
-		case 0xba: //CMP    D
-			cmp(this->d); break;
-		case 0xbb: //CMP    E
-			cmp(this->e); break;
-		case 0xbc: //CMP    H
-			cmp(this->h); break;
-		case 0xbd: //CMP    L
-			cmp(this->l); break;
-		case 0xbe: //CMP    M
-			cmp(this->memory[(this->h<<8) | (this->l)]); break;
-		case 0xbf: //CMP    A
-			cmp(this->a); break;
-		case 0xc0: //RNZ
-			ret(!this->cc[0]); break;
-		case 0xc1: //POP    B
-			this->b = this->memory[this->sp+1];
-			this->c = this->memory[this->sp];
-			this->sp += 2; break;
-		case 0xc2: //JNZ
-			if(!this->cc[0])
-				this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1;
-			else
-				this->pc += 2;
-			break;
-		case 0xc3: //JMP
-			this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1; break;
-		case 0xc4: //CNZ
-			call(!this->cc[0]); break;
-		case 0xc5: //PUSH   B
-			this->memory[this->sp-1] = this->b;    
-            this->memory[this->sp-2] = this->c;    
-            this->sp -= 2; break;
-		case 0xc6: //ADI
-			add(this->memory[this->pc+1], 0);
-			this->pc++; break;
-		case 0xc7: //RST    0
-			rst(0); break;
-		case 0xc8: //RZ
-			ret(this->cc[0]); break;
-		case 0xc9: //RET
-			ret(true); break;
-		case 0xca: //JZ
-			if(this->cc[0])
-				this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1;
-			else
-				this->pc += 2;
-			break;
-		case 0xcb: //NOP
-			break;
-		case 0xcc: //CZ
-			call(this->cc[0]); break;
-		case 0xcd: //CALL
-			// if (5 ==  ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]))    
-   //          {    
-   //              if (this->c == 9)    
-   //              {    
-   //                  uint16_t offset = (this->d<<8) | (this->e);    
-   //                  char *str = (char*) &this->memory[offset+3];  //skip the prefix bytes    
-   //                  while (*str != '$')    
-   //                      printf("%c", *str++);    
-   //                  printf("\n");    
-   //              }    
-   //              else if (this->c == 2)    
-   //              {    
-   //                  //saw this in the inspected code, never saw it called    
-   //                  printf ("print char routine called\n");    
-   //              }    
-   //          }    
-   //          else if (0 ==  ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]))    
-   //          {    
-   //              exit(0);    
-   //          }    
-   //          else    
-				call(true);
-			break;
-		case 0xce: //ACI
-			add(this->memory[this->pc+1], this->cc[3]);
-			this->pc++; break;
-		case 0xcf: //RST    1
-			rst(1); break;
-		case 0xd0: //RNC
-			ret(!this->cc[3]); break;
-		case 0xd1: //POP    D
-			this->d = this->memory[this->sp+1];
-			this->e = this->memory[this->sp];
-			this->sp += 2; break;
-		case 0xd2: //JNC
-			if(!this->cc[3])
-				this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1;
-			else
-				this->pc += 2;
-			break;
-		case 0xd3: //OUT
-			MachineOUT();
-			this->pc++; break;
-		case 0xd4: //CNC
-			call(!this->cc[3]); break;
-		case 0xd5: //PUSH   D
-			this->memory[this->sp-1] = this->d;    
-            this->memory[this->sp-2] = this->e;    
-            this->sp -= 2; break;
-		case 0xd6: //SUI
-			sub(this->memory[this->pc+1], 0);
-			this->pc++; break;
-		case 0xd7: //RST    2
-			rst(2); break;
-		case 0xd8: //RC
-			ret(this->cc[3]); break;
-		case 0xd9: //NOP
-			break;
-		case 0xda: //JC
-			if(this->cc[3])
-				this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1;
-			else
-				this->pc += 2;
-			break;
-		case 0xdb: //IN
-    	    this->a = MachineIN();
-    	    this->pc++; break;
-		case 0xdc: //CC
-			call(this->cc[3]); break;
-		case 0xdd: //NOP
-			break;
-		case 0xde: //SBI
-			sub(this->memory[this->pc+1], this->cc[3]);
-			this->pc++; break;
-		case 0xdf: //RST    3
-			rst(3); break;
-		case 0xe0: //RPO
-			ret(!this->cc[2]); break;
-		case 0xe1: //POP    H
-			this->h = this->memory[this->sp+1];
-			this->l = this->memory[this->sp];
-			this->sp += 2; break;
-		case 0xe2: //JPO
-			if(!this->cc[2])
-				this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1;
-			else
-				this->pc += 2;
-			break;
-		case 0xe3: //XTHL
-			temp8 = this->l;
-			this->l = this->memory[this->sp];
-			this->memory[this->sp] = temp8;
-			temp8 = this->h;
-			this->h = this->memory[this->sp+1];
-			this->memory[this->sp+1] = temp8; break;
-		case 0xe4: //CPO
-			call(!this->cc[2]); break;
-		case 0xe5: //PUSH   H
-			this->memory[this->sp-1] = this->h;    
-            this->memory[this->sp-2] = this->l;    
-            this->sp -= 2; break;
-		case 0xe6: //ANI
-			this->a = this->a & this->memory[this->pc+1];
-			this->cc[3] = 0;
-			this->cc[0] = ((this->a & 0xff) == 0);
-			this->cc[1] = ((this->a & 0x80) != 0);
-			this->cc[2] = Parity(this->a & 0xff);
-			this->pc++; break;
-		case 0xe7: //RST    4
-			rst(4); break;
-		case 0xe8: //RPE
-			ret(this->cc[2]); break;
-		case 0xe9: //PCHL
-			this->pc = ((this->h<<8) | (this->l)) - 1; break;
-		case 0xea: //JPE
-			if(this->cc[2])
-				this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1;
-			else
-				this->pc += 2;
-			break;
-		case 0xeb: //XCHG
-			temp8 = this->d;
-			this->d = this->h;
-			this->h = temp8;
-			temp8 = this->e;
-			this->e = this->l;
-			this->l = temp8; break;
-		case 0xec: //CPE
-			call(this->cc[2]); break;
-		case 0xed: //NOP
-			break;
-		case 0xee: //XRI
-			this->a = this->a ^ this->memory[this->pc+1];
-			this->cc[0] = ((this->a & 0xff) == 0);
-			this->cc[1] = ((this->a & 0x80) != 0);
-			this->cc[2] = Parity(this->a & 0xff);
-			this->cc[3] = 0;
-			this->pc++; break;
-		case 0xef: //RST    5
-			rst(5); break;
-		case 0xf0: //RP
-			ret(!this->cc[1]); break;
-		case 0xf1: //POP    PSW
-			this->a = this->memory[this->sp+1];
-            this->cc[3]  = (01 == (this->memory[this->sp] & 01));
-            this->cc[2]  = (04 == (this->memory[this->sp] & 04));
-            this->cc[4]  = (16 == (this->memory[this->sp] & 16));
-            this->cc[0] = (64 == (this->memory[this->sp] & 64));
-            this->cc[1] = (128 == (this->memory[this->sp] & 128));
-            this->sp += 2;  break;
-		case 0xf2: //JP
-			if(!this->cc[1])
-				this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1;
-			else
-				this->pc += 2;
-			break;
-		case 0xf3: //DI
-			this->int_enable = 0; break;
-		case 0xf4: //CP
-			call(!this->cc[1]); break;
-		case 0xf5: //PUSH   PSW
-			this->memory[this->sp-1] = this->a;
-            this->memory[this->sp-2] = (this->cc[3] | 2 |
-                            this->cc[2] << 2 |
-                            this->cc[4] << 4 |
-                            this->cc[0] << 6 |
-                            this->cc[1] << 7 );
-            this->sp -= 2; break;
-		case 0xf6: //ORI
-			this->a = this->a | this->memory[this->pc+1];
-			this->cc[0] = ((this->a & 0xff) == 0);
-			this->cc[1] = ((this->a & 0x80) != 0);
-			this->cc[2] = Parity(this->a & 0xff);
-			this->cc[3] = 0;
-			this->pc++; break;
-		case 0xf7: //RST    6
-			rst(6); break;
-		case 0xf8: //RM
-			ret(this->cc[1]); break;
-		case 0xf9: //SPHL
-			this->sp = (this->h << 8) | this->l; break;
-		case 0xfa: //JM
-			if(this->cc[1])
-				this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1;
-			else
-				this->pc += 2;
-			break;
-		case 0xfb: //EI
-			this->int_enable = 1; break;
-		case 0xfc: //CM
-			call(this->cc[1]); break;
-		case 0xfd: //NOP
+	uint8_t flags = this->flags() & (FLAG_AC | FLAG_CY);
+	if((flags & FLAG_AC) || ((this->a & 0x0f) > 9)) {
+		temp8 = (this->a & 0x0f) + 6;
+		flags = (flags & ~FLAG_AC) | (temp8 > 0x0f ? FLAG_AC : 0);
+		this->a += 6;
+	}
+	if((flags & FLAG_CY) || (this->a>>4) > 9) {
+		temp8 = (this->a>>4) + 6;
+		flags = (flags & ~FLAG_CY) | (temp8 > 0x0f ? FLAG_CY : 0);
+		this->a = (this->a&0x0f) | (temp8<<4);
+	}
+	this->setFlags(szp[this->a] | flags);
+}
+
+template<> inline void MachineState::exec<0x28>() {} //NOP
+
+template<> inline void MachineState::exec<0x29>() { //DAD    H
+	dad(this->hl);
+}
+
+template<> inline void MachineState::exec<0x2a>() { //LHLD
+	uint16_t temp16 = (this->memory[(uint16_t) (this->pc+1)]<<8) | this->memory[this->pc];
+	this->l = this->readMemory(temp16);
+	this->h = this->readMemory(temp16+1);
+	this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0x2b>() { //DCX    H
+	this->hl--;
+}
+
+template<> inline void MachineState::exec<0x2c>() { //INR    L
+	this->l = inr(this->l);
+}
+
+template<> inline void MachineState::exec<0x2d>() { //DCR    L
+	this->l = dcr(this->l);
+}
+
+template<> inline void MachineState::exec<0x2e>() { //MVI    L
+	this->l = this->memory[this->pc];
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0x2f>() { //CMA
+	this->a = ~this->a;
+}
+
+template<> inline void MachineState::exec<0x30>() {} //NOP
+
+template<> inline void MachineState::exec<0x31>() { //LXI    SP,word
+	this->sp = (this->memory[(uint16_t) (this->pc+1)]<<8) | this->memory[this->pc];
+	this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0x32>() { //STA
+	this->writeMemory(this->memory[(uint16_t) (this->pc+1)]<<8 | this->memory[this->pc], this->a);
+	this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0x33>() { //INX    SP
+	this->sp++;
+}
+
+template<> inline void MachineState::exec<0x34>() { //INR    M
+	this->writeMemory(this->hl, inr(this->readMemory(this->hl)));
+}
+
+template<> inline void MachineState::exec<0x35>() { //DCR    M
+	this->writeMemory(this->hl, dcr(this->readMemory(this->hl)));
+}
+
+template<> inline void MachineState::exec<0x36>() { //MVI    M
+	this->writeMemory(this->hl, this->memory[this->pc]);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0x37>() { //STC
+	this->f |= FLAG_CY;
+}
+
+template<> inline void MachineState::exec<0x38>() {} //NOP
+
+template<> inline void MachineState::exec<0x39>() { //DAD    SP
+	dad(this->sp);
+}
+
+template<> inline void MachineState::exec<0x3a>() { //LDA
+	this->a = this->readMemory(this->memory[(uint16_t) (this->pc+1)]<<8 | this->memory[this->pc]);
+	this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0x3b>() { //DCX    SP
+	this->sp--;
+}
+
+template<> inline void MachineState::exec<0x3c>() { //INR    A
+	this->a = inr(this->a);
+}
+
+template<> inline void MachineState::exec<0x3d>() { //DCR    A
+	this->a = dcr(this->a);
+}
+
+template<> inline void MachineState::exec<0x3e>() { //MVI    A
+	this->a = this->memory[this->pc];
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0x3f>() { //CMC
+	this->f ^= FLAG_CY;
+}
+
+//Registers by the 3 bit field MOV and the ALU group encode them in,
+//M (6) being memory[HL]
+template<> inline uint8_t& MachineState::reg<0>() { return this->b; }
+template<> inline uint8_t& MachineState::reg<1>() { return this->c; }
+template<> inline uint8_t& MachineState::reg<2>() { return this->d; }
+template<> inline uint8_t& MachineState::reg<3>() { return this->e; }
+template<> inline uint8_t& MachineState::reg<4>() { return this->h; }
+template<> inline uint8_t& MachineState::reg<5>() { return this->l; }
+template<> inline uint8_t& MachineState::reg<7>() { return this->a; }
+
+template<uint8_t R> inline uint8_t MachineState::load() { return this->reg<R>(); }
+template<> inline uint8_t MachineState::load<6>() { return this->readMemory(this->hl); }
+
+template<uint8_t R> inline void MachineState::store(uint8_t value) { this->reg<R>() = value; }
+template<> inline void MachineState::store<6>(uint8_t value) { this->writeMemory(this->hl, value); }
+
+//ADD, ADC, SUB, SBB, ANA, XRA, ORA and CMP by bits 3-5 of the opcode, shared
+//with the immediate forms
+template<uint8_t OPERATION> inline void MachineState::alu(uint8_t value) {
+	switch(OPERATION) {
+		case 0: add(value, 0); break;
+		case 1: add(value, this->f & FLAG_CY); break;
+		case 2: sub(value, 0); break;
+		case 3: sub(value, this->f & FLAG_CY); break;
+		case 4: ana(value); break;
+		case 5: xra(value); break;
+		case 6: ora(value); break;
+		case 7: cmp(value); break;
+	}
+}
+
+//MOV 0x40-0x7f and the register ALU group 0x80-0xbf are instantiated from
+//the register fields of the opcode, every other opcode is specialized
+template<uint8_t OP> inline void MachineState::exec() {
+	static_assert(OP >= 0x40 && OP < 0xc0 && OP != 0x76, "opcode has no exec specialization");
+	if(OP < 0x80)
+		this->store<(OP >> 3) & 0x07>(this->load<OP & 0x07>());	//MOV
+	else
+		this->alu<(OP >> 3) & 0x07>(this->load<OP & 0x07>());
+}
+
+template<> inline void MachineState::exec<0x76>() { //HLT
+	//Stays on the HLT until something restarts the CPU
+	this->halted = true;
+	this->pc--;
+}
+
+template<> inline void MachineState::exec<0xc0>() { //RNZ
+	ret(!this->flag(FLAG_Z));
+}
+
+template<> inline void MachineState::exec<0xc1>() { //POP    B
+	this->b = this->readMemory(this->sp+1);
+	this->c = this->readMemory(this->sp);
+	this->sp += 2;
+}
+
+template<> inline void MachineState::exec<0xc2>() { //JNZ
+	if(!this->flag(FLAG_Z))
+		this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
+	else
+		this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0xc3>() { //JMP
+	this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
+}
+
+template<> inline void MachineState::exec<0xc4>() { //CNZ
+	call(!this->flag(FLAG_Z));
+}
+
+template<> inline void MachineState::exec<0xc5>() { //PUSH   B
+	this->writeMemory(this->sp-1, this->b);
+	this->writeMemory(this->sp-2, this->c);
+	this->sp -= 2;
+}
+
+template<> inline void MachineState::exec<0xc6>() { //ADI
+	this->alu<0>(this->memory[this->pc]);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xc7>() { //RST    0
+	rst(0);
+}
+
+template<> inline void MachineState::exec<0xc8>() { //RZ
+	ret(this->flag(FLAG_Z));
+}
+
+template<> inline void MachineState::exec<0xc9>() { //RET
+	ret(true);
+}
+
+template<> inline void MachineState::exec<0xca>() { //JZ
+	if(this->flag(FLAG_Z))
+		this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
+	else
+		this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0xcb>() {} //NOP
+
+template<> inline void MachineState::exec<0xcc>() { //CZ
+	call(this->flag(FLAG_Z));
+}
+
+template<> inline void MachineState::exec<0xcd>() { //CALL
+	// if (5 ==  ((this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc]))
+   //          {
+   //              if (this->c == 9)
+   //              {
+   //                  uint16_t offset = this->de;
+   //                  char *str = (char*) &this->memory[offset+3];  //skip the prefix bytes
+   //                  while (*str != '$')
+   //                      printf("%c", *str++);
+   //                  printf("\n");
+   //              }
+   //              else if (this->c == 2)
+   //              {
+   //                  //saw this in the inspected code, never saw it called
+   //                  printf ("print char routine called\n");
+   //              }
+   //          }
+   //          else if (0 ==  ((this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc]))
+   //          {
+   //              exit(0);
+   //          }
+   //          else
+	call(true);
+}
+
+template<> inline void MachineState::exec<0xce>() { //ACI
+	this->alu<1>(this->memory[this->pc]);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xcf>() { //RST    1
+	rst(1);
+}
+
+template<> inline void MachineState::exec<0xd0>() { //RNC
+	ret(!this->flag(FLAG_CY));
+}
+
+template<> inline void MachineState::exec<0xd1>() { //POP    D
+	this->d = this->readMemory(this->sp+1);
+	this->e = this->readMemory(this->sp);
+	this->sp += 2;
+}
+
+template<> inline void MachineState::exec<0xd2>() { //JNC
+	if(!this->flag(FLAG_CY))
+		this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
+	else
+		this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0xd3>() { //OUT
+	uint8_t port = this->memory[this->pc];
+	PortDevice* device = this->outputPorts[port];
+	if(device == this->shiftRegister)
+		this->shiftRegister->write(port, this->a);
+	else
+		device->out(port, this->a);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xd4>() { //CNC
+	call(!this->flag(FLAG_CY));
+}
+
+template<> inline void MachineState::exec<0xd5>() { //PUSH   D
+	this->writeMemory(this->sp-1, this->d);
+	this->writeMemory(this->sp-2, this->e);
+	this->sp -= 2;
+}
+
+template<> inline void MachineState::exec<0xd6>() { //SUI
+	this->alu<2>(this->memory[this->pc]);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xd7>() { //RST    2
+	rst(2);
+}
+
+template<> inline void MachineState::exec<0xd8>() { //RC
+	ret(this->flag(FLAG_CY));
+}
+
+template<> inline void MachineState::exec<0xd9>() {} //NOP
+
+template<> inline void MachineState::exec<0xda>() { //JC
+	if(this->flag(FLAG_CY))
+		this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
+	else
+		this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0xdb>() { //IN
+	uint8_t port = this->memory[this->pc];
+	PortDevice* device = this->inputPorts[port];
+	if(device == this->shiftRegister)
+		this->a = this->shiftRegister->read();
+	else
+		this->a = device->in(port);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xdc>() { //CC
+	call(this->flag(FLAG_CY));
+}
+
+template<> inline void MachineState::exec<0xdd>() {} //NOP
+
+template<> inline void MachineState::exec<0xde>() { //SBI
+	this->alu<3>(this->memory[this->pc]);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xdf>() { //RST    3
+	rst(3);
+}
+
+template<> inline void MachineState::exec<0xe0>() { //RPO
+	ret(!this->flag(FLAG_P));
+}
+
+template<> inline void MachineState::exec<0xe1>() { //POP    H
+	this->h = this->readMemory(this->sp+1);
+	this->l = this->readMemory(this->sp);
+	this->sp += 2;
+}
+
+template<> inline void MachineState::exec<0xe2>() { //JPO
+	if(!this->flag(FLAG_P))
+		this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
+	else
+		this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0xe3>() { //XTHL
+	uint8_t temp8 = this->l;
+	this->l = this->readMemory(this->sp);
+	this->writeMemory(this->sp, temp8);
+	temp8 = this->h;
+	this->h = this->readMemory(this->sp+1);
+	this->writeMemory(this->sp+1, temp8);
+}
+
+template<> inline void MachineState::exec<0xe4>() { //CPO
+	call(!this->flag(FLAG_P));
+}
+
+template<> inline void MachineState::exec<0xe5>() { //PUSH   H
+	this->writeMemory(this->sp-1, this->h);
+	this->writeMemory(this->sp-2, this->l);
+	this->sp -= 2;
+}
+
+template<> inline void MachineState::exec<0xe6>() { //ANI
+	this->alu<4>(this->memory[this->pc]);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xe7>() { //RST    4
+	rst(4);
+}
+
+template<> inline void MachineState::exec<0xe8>() { //RPE
+	ret(this->flag(FLAG_P));
+}
+
+template<> inline void MachineState::exec<0xe9>() { //PCHL
+	this->pc = this->hl;
+}
+
+template<> inline void MachineState::exec<0xea>() { //JPE
+	if(this->flag(FLAG_P))
+		this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
+	else
+		this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0xeb>() { //XCHG
+	std::swap(this->de, this->hl);
+}
+
+template<> inline void MachineState::exec<0xec>() { //CPE
+	call(this->flag(FLAG_P));
+}
+
+template<> inline void MachineState::exec<0xed>() {} //NOP
+
+template<> inline void MachineState::exec<0xee>() { //XRI
+	this->alu<5>(this->memory[this->pc]);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xef>() { //RST    5
+	rst(5);
+}
+
+template<> inline void MachineState::exec<0xf0>() { //RP
+	ret(!this->flag(FLAG_S));
+}
+
+template<> inline void MachineState::exec<0xf1>() { //POP    PSW
+	this->a = this->readMemory(this->sp+1);
+	this->setFlags(this->readMemory(this->sp));
+	this->sp += 2;
+}
+
+template<> inline void MachineState::exec<0xf2>() { //JP
+	if(!this->flag(FLAG_S))
+		this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
+	else
+		this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0xf3>() { //DI
+	this->int_enable = 0;
+}
+
+template<> inline void MachineState::exec<0xf4>() { //CP
+	call(!this->flag(FLAG_S));
+}
+
+template<> inline void MachineState::exec<0xf5>() { //PUSH   PSW
+	this->writeMemory(this->sp-1, this->a);
+	this->writeMemory(this->sp-2, this->flags() | 0x02); //Bit 1 always reads as set
+	this->sp -= 2;
+}
+
+template<> inline void MachineState::exec<0xf6>() { //ORI
+	this->alu<6>(this->memory[this->pc]);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xf7>() { //RST    6
+	rst(6);
+}
+
+template<> inline void MachineState::exec<0xf8>() { //RM
+	ret(this->flag(FLAG_S));
+}
+
+template<> inline void MachineState::exec<0xf9>() { //SPHL
+	this->sp = this->hl;
+}
+
+template<> inline void MachineState::exec<0xfa>() { //JM
+	if(this->flag(FLAG_S))
+		this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
+	else
+		this->pc += 2;
+}
+
+template<> inline void MachineState::exec<0xfb>() { //EI
+	this->int_enable = 1;
+}
+
+template<> inline void MachineState::exec<0xfc>() { //CM
+	call(this->flag(FLAG_S));
+}
+
+template<> inline void MachineState::exec<0xfd>() {} //NOP
+
+template<> inline void MachineState::exec<0xfe>() { //CPI
+	this->alu<7>(this->memory[this->pc]);
+	this->pc++;
+}
+
+template<> inline void MachineState::exec<0xff>() { //RST    7
+	rst(7);
+}
+
+//Expands X once for every opcode 0x00-0xff as a hex literal, so the dispatch
+//engines below can build case labels, handler tables and goto labels from it
+#define OPCODE_ROW(X, hi) \
+	X(0x##hi##0) X(0x##hi##1) X(0x##hi##2) X(0x##hi##3) \
+	X(0x##hi##4) X(0x##hi##5) X(0x##hi##6) X(0x##hi##7) \
+	X(0x##hi##8) X(0x##hi##9) X(0x##hi##a) X(0x##hi##b) \
+	X(0x##hi##c) X(0x##hi##d) X(0x##hi##e) X(0x##hi##f)
+#define FOR_EACH_OPCODE(X) \
+	OPCODE_ROW(X, 0) OPCODE_ROW(X, 1) OPCODE_ROW(X, 2) OPCODE_ROW(X, 3) \
+	OPCODE_ROW(X, 4) OPCODE_ROW(X, 5) OPCODE_ROW(X, 6) OPCODE_ROW(X, 7) \
+	OPCODE_ROW(X, 8) OPCODE_ROW(X, 9) OPCODE_ROW(X, a) OPCODE_ROW(X, b) \
+	OPCODE_ROW(X, c) OPCODE_ROW(X, d) OPCODE_ROW(X, e) OPCODE_ROW(X, f)
+
+#define OPCODE_HANDLER(code) &MachineState::step<code>,
+const MachineState::OpHandler MachineState::opTable[256] = {
+	FOR_EACH_OPCODE(OPCODE_HANDLER)
+};
+#undef OPCODE_HANDLER
+
+void MachineState::processCommand() {
+#if defined(DISPATCH_SWITCH)
+	this->runSwitch(1);
+#else
+	this->runTable(1);
+#endif
+}
+
+void MachineState::processCommands(uint64_t count) {
+#if defined(DISPATCH_SWITCH)
+	this->runSwitch(count);
+#elif defined(DISPATCH_CACHED)
+	this->runCached(count);
+#elif defined(DISPATCH_JIT)
+	this->runJit(count);
+#elif defined(DISPATCH_TABLE) || !defined(HAVE_COMPUTED_GOTO)
+	this->runTable(count);
+#else
+	this->runThreaded(count);
+#endif
+}
+
+uint64_t MachineState::run(uint64_t cycles) {
+	//No instruction takes more than MAX_OP_CYCLES, so a batch of
+	//remaining / MAX_OP_CYCLES instructions never overshoots the next event or
+	//the end of the budget, and the last few cycles before either go one
+	//instruction at a time. Events are only looked at between batches.
+	const uint64_t start = this->cycles;
+	const uint64_t target = start + cycles;
+	while(true) {
+		//Interrupts taken by events add cycles of their own, which can bring
+		//another event due or run out the budget. Once nothing is due the
+		//next event is ahead, so stop is never behind the cycle count.
+		while(this->events.next() <= this->cycles)
+			this->events.runDue(this->cycles);
+		if(this->cycles >= target)
 			break;
-		case 0xfe: //CPI
-			cmp(this->memory[this->pc+1]);
-			this->pc++; break;
-		case 0xff: //RST    7
-			rst(7); break;
+		const uint64_t stop = std::min(target, this->events.next());
+		uint64_t batch = (stop - this->cycles) / MAX_OP_CYCLES;
+		//Nothing can wake a halted or idling CPU before the next event
+		if(this->halted || (this->idleSkip && batch >= IDLE_LOOP_OPS && this->idleLoop())) {
+			this->cycles = stop;
+			continue;
+		}
+		//A loop that turned out not to be idle has already run some of the batch
+		if(this->idleSkip && batch >= IDLE_LOOP_OPS) {
+			if(this->cycles >= stop)
+				continue;
+			batch = (stop - this->cycles) / MAX_OP_CYCLES;
+		}
+		if(this->idleSkip && batch > IDLE_CHECK_OPS)
+			batch = IDLE_CHECK_OPS;
+		this->processCommands(std::max<uint64_t>(1, batch));
+	}
+	return this->cycles - start;
+}
+
+//A batch of one through the handler table, so a debugger can look at the
+//machine between any two instructions and still see events fire at the
+//same places. A halted CPU goes straight to the next event, or nowhere and
+//returns 0 when none is scheduled.
+uint64_t MachineState::runInstruction() {
+	//Only the earliest event needs looking at to know whether any are due.
+	//As in run, events are fired until none are, counting their interrupts.
+	const uint64_t start = this->cycles;
+	while(this->events.next() <= this->cycles)
+		this->events.runDue(this->cycles);
+	if(!this->halted)
+		opTable[this->memory[this->pc++]](*this);
+	else if(this->events.next() != UINT64_MAX)
+		this->cycles = std::max(this->cycles, this->events.next());
+	while(this->events.next() <= this->cycles)
+		this->events.runDue(this->cycles);
+	return this->cycles - start;
+}
+
+bool MachineState::interrupt(uint8_t number) {
+	if(!this->int_enable)
+		return false;
+	this->int_enable = 0;
+	if(this->halted) {
+		this->halted = false;
+		this->pc++; //Returns to the instruction after the HLT
+	}
+	this->cycles += opcodes[0xc7 | (number << 3)].cycles;
+	this->rst(number);
+	return true;
+}
+
+//Loads, arithmetic and branches, nothing that stores, does I/O or changes
+//the interrupt state
+static bool sideEffectFree(uint8_t op) {
+	switch(op) {
+		case 0x02: case 0x12: case 0x22: case 0x32:	//STAX, SHLD, STA
+		case 0x34: case 0x35: case 0x36:			//INR M, DCR M, MVI M
+		case 0x76: case 0xd3: case 0xdb:			//HLT, OUT, IN
+		case 0xe3: case 0xf3: case 0xfb:			//XTHL, DI, EI
+			return false;
+	}
+	if(op >= 0x70 && op < 0x78)						//MOV M,r
+		return false;
+	if(op >= 0xc0 && ((op & 0x0f) == 0x05 || (op & 0x07) == 0x04 || (op & 0x07) == 0x07 || op == 0xcd))
+		return false;								//PUSH, Ccc, RST, CALL
+	return true;
+}
+
+//A loop that only reads RAM and gets back to where it started with every
+//register unchanged spins the same way until an interrupt. One pass is
+//stepped through to find out, the instructions it runs count as executed.
+bool MachineState::idleLoop() {
+	//Device pages can answer differently on every read
+	if(this->devicePages != 0)
+		return false;
+	const uint16_t start = this->pc, sp = this->sp, bc = this->bc, de = this->de, hl = this->hl;
+	const uint8_t a = this->a, flags = this->flags();
+	for(unsigned int i = 0; i < IDLE_LOOP_OPS; i++) {
+		if(!sideEffectFree(this->memory[this->pc]))
+			return false;
+		this->processCommand();
+		if(this->pc == start)
+			return this->a == a && this->flags() == flags && this->bc == bc && this->de == de && this->hl == hl && this->sp == sp;
+	}
+	return false;
+}
+
+void MachineState::runSwitch(uint64_t count) {
+#define OPCODE_CASE(code) case code: this->cycles += opcodes[code].cycles; this->exec<code>(); break;
+	for(; count > 0; count--) {
+		switch(this->memory[this->pc++]) {
+			FOR_EACH_OPCODE(OPCODE_CASE)
+		}
 	}
+#undef OPCODE_CASE
+}
+
+void MachineState::runTable(uint64_t count) {
+	for(; count > 0; count--)
+		opTable[this->memory[this->pc++]](*this);
+}
+
+#ifdef HAVE_COMPUTED_GOTO
+void MachineState::runThreaded(uint64_t count) {
+	//Every handler ends in its own indirect jump to the next one, giving the
+	//branch predictor one history per opcode instead of a single shared switch
+#define OPCODE_LABEL(code) &&op_##code,
+#define OPCODE_BODY(code) op_##code: this->cycles += opcodes[code].cycles; this->exec<code>(); DISPATCH();
+#define DISPATCH() if(--count == 0) return; goto *labels[this->memory[this->pc++]]
+	static void* const labels[256] = {
+		FOR_EACH_OPCODE(OPCODE_LABEL)
+	};
+	if(count == 0) return;
+	goto *labels[this->memory[this->pc++]];
+	FOR_EACH_OPCODE(OPCODE_BODY)
+#undef DISPATCH
+#undef OPCODE_BODY
+#undef OPCODE_LABEL
+}
+#endif
+
+MachineState::Block* MachineState::decodeBlock(uint16_t start) {
+	std::unique_ptr<Block> block(new Block());
+	uint32_t address = start;
+	uint8_t op;
+	do {
+		op = this->memory[address & 0xffff];
+#ifdef HAVE_COMPUTED_GOTO
+		block->ops.push_back(cachedLabels[op]);
+#else
+		block->ops.push_back(opTable[op]);
+#endif
+		address += opcodes[op].length;
+	} while(!opcodes[op].endsBlock && block->ops.size() < MAX_BLOCK_OPS);
+
+	for(uint32_t page = start >> 8; page <= (address - 1) >> 8; page++) {
+		this->pageBlocks[page & 0xff].push_back(start);
+		this->pageFlags[page & 0xff] |= PAGE_CODE;
+	}
+	block->length = address - start;
+	this->blocks[start] = std::move(block);
+	return this->blocks[start].get();
+}
+
+void MachineState::invalidateCode(uint16_t address) {
+	//Blocks are only retired here since one of them may still be running
+	std::vector<uint16_t>& starts = this->pageBlocks[address >> 8];
+	for(size_t i = 0; i < starts.size(); ) {
+		std::unique_ptr<Block>& block = this->blocks[starts[i]];
+		if(block && (uint16_t) (address - starts[i]) >= block->length) {
+			i++;
+			continue;
+		}
+		if(block) {
+			this->retiredBlocks.push_back(std::move(block));
+			this->blockInvalidated = true;
+		}
+		starts[i] = starts.back();
+		starts.pop_back();
+	}
+	if(starts.empty())
+		this->pageFlags[address >> 8] &= ~PAGE_CODE;
+}
+
+//Drops every cached block touching the page, for when all of it changes at once
+void MachineState::invalidatePage(uint8_t page) {
+	for(uint16_t start : this->pageBlocks[page]) {
+		std::unique_ptr<Block>& block = this->blocks[start];
+		if(block) {
+			this->retiredBlocks.push_back(std::move(block));
+			this->blockInvalidated = true;
+		}
+	}
+	this->pageBlocks[page].clear();
+	this->pageFlags[page] &= ~PAGE_CODE;
+}
+
+void MachineState::flushBlocks() {
+	for(std::unique_ptr<Block>& block : this->blocks) {
+		if(block)
+			this->retiredBlocks.push_back(std::move(block));
+	}
+	for(unsigned int page = 0; page < 256; page++) {
+		this->pageBlocks[page].clear();
+		this->pageFlags[page] &= ~PAGE_CODE;
+	}
+	this->blockInvalidated = true;
+}
+
+#ifdef HAVE_COMPUTED_GOTO
+const void* const* MachineState::cachedLabels = nullptr;
+
+void MachineState::runCached(uint64_t count) {
+	//Blocks hold the goto label of each handler, so replaying one jumps
+	//straight from handler to handler without fetching any opcodes
+#define OPCODE_LABEL(code) &&cached_##code,
+#define OPCODE_BODY(code) cached_##code: this->cycles += opcodes[code].cycles; this->exec<code>(); DISPATCH();
+#define DISPATCH() if(++op == end || this->blockInvalidated) goto blockEnd; this->pc++; goto **op
+	static const void* const labels[256] = {
+		FOR_EACH_OPCODE(OPCODE_LABEL)
+	};
+	cachedLabels = labels;
+	if(this->blocks.empty())
+		this->blocks.resize(0x10000);
+
+	Block* block;
+	const void* const* op;
+	const void* const* end;
+nextBlock:
+	if(count == 0) return;
+	this->retiredBlocks.clear();
+	block = this->blocks[this->pc].get();
+	if(block == nullptr)
+		block = this->decodeBlock(this->pc);
+	//A store into cached code ends the block early, the rest is decoded again
+	this->blockInvalidated = false;
+	op = block->ops.data();
+	end = op + std::min<uint64_t>(count, block->ops.size());
+	count -= end - op;
 	this->pc++;
+	goto **op;
+	FOR_EACH_OPCODE(OPCODE_BODY)
+blockEnd:
+	count += end - op;
+	goto nextBlock;
+#undef DISPATCH
+#undef OPCODE_BODY
+#undef OPCODE_LABEL
 }
+#else
+void MachineState::runCached(uint64_t count) {
+	if(this->blocks.empty())
+		this->blocks.resize(0x10000);
+	while(count > 0) {
+		this->retiredBlocks.clear();
+		Block* block = this->blocks[this->pc].get();
+		if(block == nullptr)
+			block = this->decodeBlock(this->pc);
+
+		//A store into cached code ends the block early, the rest is decoded again
+		this->blockInvalidated = false;
+		uint64_t run = std::min<uint64_t>(count, block->ops.size());
+		for(uint64_t i = 0; i < run; ) {
+			this->pc++;
+			block->ops[i++](*this);
+			if(this->blockInvalidated) {
+				run = i;
+				break;
+			}
+		}
+		count -= run;
+	}
+}
+#endif
 
 void MachineState::sub(uint8_t num, uint8_t carry) {
+	//Subtraction is A + ~num + !borrow, carry out of bit 7 means no borrow
 	num = ~num;
-	carry = ~carry;
-	num++;
-	carry++;
-	uint16_t answer = (uint16_t) this->a + (uint16_t) num + (uint16_t) carry;
-	this->cc[0] = ((answer & 0xff) == 0);
-	this->cc[1] = ((answer & 0x80) != 0);
-	this->cc[2] = Parity(answer & 0xff);
-	this->cc[3] = !(answer > 0xff);
-	this->cc[4] = ((this->a & 0x0f) + (num & 0x0f) + carry) > 0x0f;
+	uint16_t answer = (uint16_t) this->a + (uint16_t) num + !carry;
+	this->setAddFlags(answer & 0xff, this->a, num, ((answer >> 8) & FLAG_CY) ^ FLAG_CY);
 	this->a = answer & 0xff;
 }
 
 void MachineState::add(uint8_t num, uint16_t carry) {
 	uint16_t answer = (uint16_t) this->a + (uint16_t) num + carry;
-	this->cc[0] = ((answer & 0xff) == 0);
-	this->cc[1] = ((answer & 0x80) != 0);
-	this->cc[2] = Parity(answer & 0xff);
-	this->cc[3] = (answer > 0xff);
-	this->cc[4] = ((this->a & 0x0f) + (num & 0x0f) + carry) > 0x0f;
+	this->setAddFlags(answer & 0xff, this->a, num, (answer >> 8) & FLAG_CY);
 	this->a = answer & 0xff;
 }
 
+uint8_t MachineState::inr(uint8_t num) {
+	this->setAddFlags(num + 1, num, 1, this->f & FLAG_CY);
+	return num + 1;
+}
+
+uint8_t MachineState::dcr(uint8_t num) {
+	this->setAddFlags(num - 1, num, 0xff, this->f & FLAG_CY);
+	return num - 1;
+}
+
 void MachineState::call(bool condition) {
 	if(condition) {
-		uint16_t ret = (uint16_t) this->pc + 3;
-		this->memory[this->sp-1] = (ret >> 8) & 0xff;
-		this->memory[this->sp-2] = (ret & 0xff);
+		this->takenCycles();
+		uint16_t ret = (uint16_t) this->pc + 2;
+		this->writeMemory(this->sp-1, (ret >> 8) & 0xff);
+		this->writeMemory(this->sp-2, (ret & 0xff));
 		this->sp -= 2;
-		this->pc = ((this->memory[this->pc+2] << 8) | this->memory[this->pc+1]) - 1;
+		this->pc = (this->memory[(uint16_t) (this->pc+1)] << 8) | this->memory[this->pc];
 	}
 	else
 		this->pc += 2;
@@ -910,940 +1497,95 @@ void MachineState::call(bool condition) {
 
 void MachineState::ret(bool condition) {
 	if(condition) {
-		this->pc = (this->memory[this->sp] | (this->memory[this->sp+1] << 8)) - 1;
+		this->takenCycles();
+		this->pc = this->readMemory(this->sp) | (this->readMemory(this->sp+1) << 8);
 		this->sp += 2;
 	}
 }
 
+//call and ret run with pc just past the opcode, only the conditional ones
+//have a taken cost above what was already added
+void MachineState::takenCycles() {
+	const OpcodeInfo& info = opcodes[this->memory[(uint16_t) (this->pc - 1)]];
+	this->cycles += info.takenCycles - info.cycles;
+}
+
 void MachineState::ana(uint8_t num) {
+	this->setLogicFlags(this->a & num, this->a | num);
 	this->a = this->a & num;
-	this->cc[0] = ((this->a & 0xff) == 0);
-	this->cc[1] = ((this->a & 0x80) != 0);
-	this->cc[2] = Parity(this->a);
-	this->cc[3] = 0;
-	this->cc[4] = 0;
 }
 
 void MachineState::xra(uint8_t num) {
 	this->a = this->a ^ num;
-	this->cc[0] = ((this->a & 0xff) == 0);
-	this->cc[1] = ((this->a & 0x80) != 0);
-	this->cc[2] = Parity(this->a);
-	this->cc[3] = 0;
-	this->cc[4] = 0;
+	this->setLogicFlags(this->a, 0);
 }
 
 void MachineState::ora(uint8_t num) {
 	this->a = this->a | num;
-	this->cc[0] = ((this->a & 0xff) == 0);
-	this->cc[1] = ((this->a & 0x80) != 0);
-	this->cc[2] = Parity(this->a);
-	this->cc[3] = 0;
-	this->cc[4] = 0;
+	this->setLogicFlags(this->a, 0);
 }
 
 void MachineState::cmp(uint8_t num) {
 	uint8_t tmp = ~num;
-	tmp++;
-	uint16_t answer = (uint16_t) this->a + (uint16_t) tmp;
-	this->cc[0] = ((answer & 0xff) == 0);
-	this->cc[1] = ((answer & 0x80) != 0);
-	this->cc[2] = Parity(answer & 0xff);
-	this->cc[3] = (num > this->a);
-	this->cc[4] = ((this->a & 0x0f) + (tmp & 0x0f)) > 0x0f;
+	uint16_t answer = (uint16_t) this->a + (uint16_t) tmp + 1;
+	this->setAddFlags(answer & 0xff, this->a, tmp, ((answer >> 8) & FLAG_CY) ^ FLAG_CY);
 }
 
 void MachineState::dad(uint16_t num) {
-	uint32_t tmp = (this->h<<8 | this->l) + num;
-	this->cc[3] = (tmp > 0xffff);
-	uint16_t answer = tmp & 0xffff;
-	this->h = answer>>8;
-	this->l = tmp & 0xff;
+	uint32_t tmp = this->hl + num;
+	this->f = (this->f & ~FLAG_CY) | ((tmp >> 16) & FLAG_CY);
+	this->hl = tmp;
 }
 
 void MachineState::rst(uint8_t num) {
-	this->sp--;
-	this->memory[this->sp] = (this->pc&0xff);
-	this->sp--;
-	this->memory[this->sp] = (this->pc>>4);
-}
-
-uint8_t MachineState::MachineIN() {
-	uint8_t port = this->memory[this->pc+1];
-	uint16_t temp16;
-	uint8_t answer;
-	switch(port) {
-		case 3:
-			temp16 = (shift1<<8) | shift0;
-			answer = ((temp16 >> (8-shift_offset)) & 0xff);
-			break;
-	}
-	return answer;
-}
-
-void MachineState::MachineOUT() { //Example has uint8_t value parameter from somewhere?
-	uint8_t port = this->memory[this->pc+1];
-	switch(port) {
-		case 2:
-			shift_offset = value & 0x7;
-			break;
-		case 4:
-			shift0 = shift1;
-			shift1 = value;
-	}
+	this->writeMemory(this->sp-1, (this->pc >> 8) & 0xff);
+	this->writeMemory(this->sp-2, (this->pc & 0xff));
+	this->sp -= 2;
+	this->pc = num * 8;
 }
 
 int MachineState::getOpcode(uint16_t index) const {
-	unsigned char code = memory[index];
-	int opBytes = 1;
+	const OpcodeInfo& info = opcodes[memory[index]];
+	uint8_t byte2 = memory[(uint16_t) (index+1)], byte3 = memory[(uint16_t) (index+2)];
 	std::cout << std::hex << std::setw(4) << std::setfill('0') << index << " ";
-	switch(code)
-	{
-		case 0x00: 
-			std::cout << "NOP"; break;
-		case 0x01:
-			std::cout << "LXI    B,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0x02: 
-			std::cout << "STAX   B"; break;
-		case 0x03: 
-			std::cout << "INX    B"; break;
-		case 0x04: 
-			std::cout << "INR    B"; break;
-		case 0x05: 
-			std::cout << "DCR    B"; break;
-		case 0x06: 
-			std::cout << "MVI    B,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0x07:
-			std::cout << "RLC"; break;
-		case 0x08: 
-			std::cout << "NOP"; break;
-		case 0x09: 
-			std::cout << "DAD    B"; break;
-		case 0x0a: 
-			std::cout << "LDAX   B"; break;
-		case 0x0b: 
-			std::cout << "DCX    B"; break;
-		case 0x0c: 
-			std::cout << "INR    C"; break;
-		case 0x0d: 
-			std::cout << "DCR    C"; break;
-		case 0x0e: 
-			std::cout << "MVI    C,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0x0f:
-			std::cout << "RRC"; break;
-		case 0x10: 
-			std::cout << "NOP"; break;
-		case 0x11:
-			std::cout << "LXI    D,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0x12: 
-			std::cout << "STAX   D"; break;
-		case 0x13: 
-			std::cout << "INX    D"; break;
-		case 0x14: 
-			std::cout << "INR    D"; break;
-		case 0x15: 
-			std::cout << "DCR    D"; break;
-		case 0x16: 
-			std::cout << "MVI    D,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0x17:
-			std::cout << "RAL"; break;
-		case 0x18: 
-			std::cout << "NOP"; break;
-		case 0x19: 
-			std::cout << "DAD    D"; break;
-		case 0x1a: 
-			std::cout << "LDAX   D"; break;
-		case 0x1b: 
-			std::cout << "DCX    D"; break;
-		case 0x1c: 
-			std::cout << "INR    E"; break;
-		case 0x1d: 
-			std::cout << "DCR    E"; break;
-		case 0x1e: 
-			std::cout << "MVI    E,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0x1f:
-			std::cout << "RAR"; break;
-		case 0x20:
-			std::cout << "NOP"; break;
-		case 0x21:
-			std::cout << "LXI    H,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0x22:
-			std::cout << "SHLD   $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0x23: 
-			std::cout << "INX    H"; break;
-		case 0x24: 
-			std::cout << "INR    H"; break;
-		case 0x25: 
-			std::cout << "DCR    H"; break;
-		case 0x26: 
-			std::cout << "MVI    H,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0x27:
-			std::cout << "DAA"; break;
-		case 0x28: 
-			std::cout << "NOP"; break;
-		case 0x29: 
-			std::cout << "DAD    H"; break;
-		case 0x2a: 
-			std::cout << "LHLD   $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0x2b: 
-			std::cout << "DCX    H"; break;
-		case 0x2c: 
-			std::cout << "INR    L"; break;
-		case 0x2d: 
-			std::cout << "DCR    L"; break;
-		case 0x2e: 
-			std::cout << "MVI    L,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0x2f:
-			std::cout << "CMA"; break;
-		case 0x30:
-			std::cout << "NOP"; break;
-		case 0x31:
-			std::cout << "LXI    SP,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0x32:
-			std::cout << "STA    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0x33: 
-			std::cout << "INX    SP"; break;
-		case 0x34: 
-			std::cout << "INR    M"; break;
-		case 0x35: 
-			std::cout << "DCR    M"; break;
-		case 0x36: 
-			std::cout << "MVI    M,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0x37:
-			std::cout << "STC"; break;
-		case 0x38: 
-			std::cout << "NOP"; break;
-		case 0x39: 
-			std::cout << "DAD    SP"; break;
-		case 0x3a: 
-			std::cout << "LDA    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0x3b: 
-			std::cout << "DCX    SP"; break;
-		case 0x3c: 
-			std::cout << "INR    A"; break;
-		case 0x3d: 
-			std::cout << "DCR    A"; break;
-		case 0x3e: 
-			std::cout << "MVI    A,#$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0x3f:
-			std::cout << "CMC"; break;
-		case 0x40:
-			std::cout << "MOV    B,B"; break;
-		case 0x41:
-			std::cout << "MOV    B,C"; break;
-		case 0x42:
-			std::cout << "MOV    B,D"; break;
-		case 0x43:
-			std::cout << "MOV    B,E"; break;
-		case 0x44:
-			std::cout << "MOV    B,H"; break;
-		case 0x45:
-			std::cout << "MOV    B,L"; break;
-		case 0x46:
-			std::cout << "MOV    B,M"; break;
-		case 0x47:
-			std::cout << "MOV    B,A"; break;
-		case 0x48:
-			std::cout << "MOV    C,B"; break;
-		case 0x49:
-			std::cout << "MOV    C,C"; break;
-		case 0x4a:
-			std::cout << "MOV    C,D"; break;
-		case 0x4b:
-			std::cout << "MOV    C,E"; break;
-		case 0x4c:
-			std::cout << "MOV    C,H"; break;
-		case 0x4d:
-			std::cout << "MOV    C,L"; break;
-		case 0x4e:
-			std::cout << "MOV    C,M"; break;
-		case 0x4f:
-			std::cout << "MOV    C,A"; break;
-		case 0x50:
-			std::cout << "MOV    D,B"; break;
-		case 0x51:
-			std::cout << "MOV    D,C"; break;
-		case 0x52:
-			std::cout << "MOV    D,D"; break;
-		case 0x53:
-			std::cout << "MOV    D,E"; break;
-		case 0x54:
-			std::cout << "MOV    D,H"; break;
-		case 0x55:
-			std::cout << "MOV    D,L"; break;
-		case 0x56:
-			std::cout << "MOV    D,M"; break;
-		case 0x57:
-			std::cout << "MOV    D,A"; break;
-		case 0x58:
-			std::cout << "MOV    E,B"; break;
-		case 0x59:
-			std::cout << "MOV    E,C"; break;
-		case 0x5a:
-			std::cout << "MOV    E,D"; break;
-		case 0x5b:
-			std::cout << "MOV    E,E"; break;
-		case 0x5c:
-			std::cout << "MOV    E,H"; break;
-		case 0x5d:
-			std::cout << "MOV    E,L"; break;
-		case 0x5e:
-			std::cout << "MOV    E,M"; break;
-		case 0x5f:
-			std::cout << "MOV    E,A"; break;
-		case 0x60:
-			std::cout << "MOV    H,B"; break;
-		case 0x61:
-			std::cout << "MOV    H,C"; break;
-		case 0x62:
-			std::cout << "MOV    H,D"; break;
-		case 0x63:
-			std::cout << "MOV    H,E"; break;
-		case 0x64:
-			std::cout << "MOV    H,H"; break;
-		case 0x65:
-			std::cout << "MOV    H,L"; break;
-		case 0x66:
-			std::cout << "MOV    H,M"; break;
-		case 0x67:
-			std::cout << "MOV    H,A"; break;
-		case 0x68:
-			std::cout << "MOV    L,B"; break;
-		case 0x69:
-			std::cout << "MOV    L,C"; break;
-		case 0x6a:
-			std::cout << "MOV    L,D"; break;
-		case 0x6b:
-			std::cout << "MOV    L,E"; break;
-		case 0x6c:
-			std::cout << "MOV    L,H"; break;
-		case 0x6d:
-			std::cout << "MOV    L,L"; break;
-		case 0x6e:
-			std::cout << "MOV    L,M"; break;
-		case 0x6f:
-			std::cout << "MOV    L,A"; break;
-		case 0x70:
-			std::cout << "MOV    M,B"; break;
-		case 0x71:
-			std::cout << "MOV    M,C"; break;
-		case 0x72:
-			std::cout << "MOV    M,D"; break;
-		case 0x73:
-			std::cout << "MOV    M,E"; break;
-		case 0x74:
-			std::cout << "MOV    M,H"; break;
-		case 0x75:
-			std::cout << "MOV    M,L"; break;
-		case 0x76:
-			std::cout << "HLT"; break;
-		case 0x77:
-			std::cout << "MOV    M,A"; break;
-		case 0x78:
-			std::cout << "MOV    A,B"; break;
-		case 0x79:
-			std::cout << "MOV    A,C"; break;
-		case 0x7a:
-			std::cout << "MOV    A,D"; break;
-		case 0x7b:
-			std::cout << "MOV    A,E"; break;
-		case 0x7c:
-			std::cout << "MOV    A,H"; break;
-		case 0x7d:
-			std::cout << "MOV    A,L"; break;
-		case 0x7e:
-			std::cout << "MOV    A,M"; break;
-		case 0x7f:
-			std::cout << "MOV    A,A"; break;
-		case 0x80:
-			std::cout << "ADD    B"; break;
-		case 0x81:
-			std::cout << "ADD    C"; break;
-		case 0x82:
-			std::cout << "ADD    D"; break;
-		case 0x83:
-			std::cout << "ADD    E"; break;
-		case 0x84:
-			std::cout << "ADD    H"; break;
-		case 0x85:
-			std::cout << "ADD    L"; break;
-		case 0x86:
-			std::cout << "ADD    M"; break;
-		case 0x87:
-			std::cout << "ADD    A"; break;
-		case 0x88:
-			std::cout << "ADC    B"; break;
-		case 0x89:
-			std::cout << "ADC    C"; break;
-		case 0x8a:
-			std::cout << "ADC    D"; break;
-		case 0x8b:
-			std::cout << "ADC    E"; break;
-		case 0x8c:
-			std::cout << "ADC    H"; break;
-		case 0x8d:
-			std::cout << "ADC    L"; break;
-		case 0x8e:
-			std::cout << "ADC    M"; break;
-		case 0x8f:
-			std::cout << "ADC    A"; break;
-		case 0x90:
-			std::cout << "SUB    B"; break;
-		case 0x91:
-			std::cout << "SUB    C"; break;
-		case 0x92:
-			std::cout << "SUB    D"; break;
-		case 0x93:
-			std::cout << "SUB    E"; break;
-		case 0x94:
-			std::cout << "SUB    H"; break;
-		case 0x95:
-			std::cout << "SUB    L"; break;
-		case 0x96:
-			std::cout << "SUB    M"; break;
-		case 0x97:
-			std::cout << "SUB    A"; break;
-		case 0x98:
-			std::cout << "SBB    B"; break;
-		case 0x99:
-			std::cout << "SBB    C"; break;
-		case 0x9a:
-			std::cout << "SBB    D"; break;
-		case 0x9b:
-			std::cout << "SBB    E"; break;
-		case 0x9c:
-			std::cout << "SBB    H"; break;
-		case 0x9d:
-			std::cout << "SBB    L"; break;
-		case 0x9e:
-			std::cout << "SBB    M"; break;
-		case 0x9f:
-			std::cout << "SBB    A"; break;
-		case 0xa0:
-			std::cout << "ANA    B"; break;
-		case 0xa1:
-			std::cout << "ANA    C"; break;
-		case 0xa2:
-			std::cout << "ANA    D"; break;
-		case 0xa3:
-			std::cout << "ANA    E"; break;
-		case 0xa4:
-			std::cout << "ANA    H"; break;
-		case 0xa5:
-			std::cout << "ANA    L"; break;
-		case 0xa6:
-			std::cout << "ANA    M"; break;
-		case 0xa7:
-			std::cout << "ANA    A"; break;
-		case 0xa8:
-			std::cout << "XRA    B"; break;
-		case 0xa9:
-			std::cout << "XRA    C"; break;
-		case 0xaa:
-			std::cout << "XRA    D"; break;
-		case 0xab:
-			std::cout << "XRA    E"; break;
-		case 0xac:
-			std::cout << "XRA    H"; break;
-		case 0xad:
-			std::cout << "XRA    L"; break;
-		case 0xae:
-			std::cout << "XRA    M"; break;
-		case 0xaf:
-			std::cout << "XRA    A"; break;
-		case 0xb0:
-			std::cout << "ORA    B"; break;
-		case 0xb1:
-			std::cout << "ORA    C"; break;
-		case 0xb2:
-			std::cout << "ORA    D"; break;
-		case 0xb3:
-			std::cout << "ORA    E"; break;
-		case 0xb4:
-			std::cout << "ORA    H"; break;
-		case 0xb5:
-			std::cout << "ORA    L"; break;
-		case 0xb6:
-			std::cout << "ORA    M"; break;
-		case 0xb7:
-			std::cout << "ORA    A"; break;
-		case 0xb8:
-			std::cout << "CMP    B"; break;
-		case 0xb9:
-			std::cout << "CMP    C"; break;
-		case 0xba:
-			std::cout << "CMP    D"; break;
-		case 0xbb:
-			std::cout << "CMP    E"; break;
-		case 0xbc:
-			std::cout << "CMP    H"; break;
-		case 0xbd:
-			std::cout << "CMP    L"; break;
-		case 0xbe:
-			std::cout << "CMP    M"; break;
-		case 0xbf:
-			std::cout << "CMP    A"; break;
-		case 0xc0:
-			std::cout << "RNZ"; break;
-		case 0xc1:
-			std::cout << "POP    B"; break;
-		case 0xc2:
-			std::cout << "JNZ    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xc3:
-			std::cout << "JMP    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xc4:
-			std::cout << "CNZ    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xc5:
-			std::cout << "PUSH   B"; break;
-		case 0xc6:
-			std::cout << "ADI    #$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xc7:
-			std::cout << "RST    0"; break;
-		case 0xc8:
-			std::cout << "RZ"; break;
-		case 0xc9:
-			std::cout << "RET"; break;
-		case 0xca:
-			std::cout << "JZ     $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xcb:
-			std::cout << "NOP"; break;
-		case 0xcc:
-			std::cout << "CZ     $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xcd:
-			std::cout << "CALL   $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xce:
-			std::cout << "ACI    " << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xcf:
-			std::cout << "RST    1"; break;
-		case 0xd0:
-			std::cout << "RNC"; break;
-		case 0xd1:
-			std::cout << "POP    D"; break;
-		case 0xd2:
-			std::cout << "JNC    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xd3:
-			std::cout << "OUT    #$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xd4:
-			std::cout << "CNC    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xd5:
-			std::cout << "PUSH   D"; break;
-		case 0xd6:
-			std::cout << "SUI    #$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xd7:
-			std::cout << "RST    2"; break;
-		case 0xd8:
-			std::cout << "RC"; break;
-		case 0xd9:
-			std::cout << "NOP"; break;
-		case 0xda:
-			std::cout << "JC     $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xdb:
-			std::cout << "IN     #$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xdc:
-			std::cout << "CC     $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xdd:
-			std::cout << "NOP"; break;
-		case 0xde:
-			std::cout << "SBI    #$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xdf:
-			std::cout << "RST    3"; break;
-		case 0xe0:
-			std::cout << "RPO"; break;
-		case 0xe1:
-			std::cout << "POP    H"; break;
-		case 0xe2:
-			std::cout << "JPO    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xe3:
-			std::cout << "XTHL"; break;
-		case 0xe4:
-			std::cout << "CPO    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xe5:
-			std::cout << "PUSH   H"; break;
-		case 0xe6:
-			std::cout << "ANI    #$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xe7:
-			std::cout << "RST    4"; break;
-		case 0xe8:
-			std::cout << "RPE"; break;
-		case 0xe9:
-			std::cout << "PCHL"; break;
-		case 0xea:
-			std::cout << "JPE    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xeb:
-			std::cout << "XCHG"; break;
-		case 0xec:
-			std::cout << "CPE    $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xed:
-			std::cout << "NOP"; break;
-		case 0xee:
-			std::cout << "XRI    #$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xef:
-			std::cout << "RST    5"; break;
-		case 0xf0:
-			std::cout << "RP"; break;
-		case 0xf1:
-			std::cout << "POP    PSW"; break;
-		case 0xf2:
-			std::cout << "JP     $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xf3:
-			std::cout << "DI"; break;
-		case 0xf4:
-			std::cout << "CP     $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xf5:
-			std::cout << "PUSH   PSW"; break;
-		case 0xf6:
-			std::cout << "ORI    #$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xf7:
-			std::cout << "RST    6"; break;
-		case 0xf8:
-			std::cout << "RM"; break;
-		case 0xf9:
-			std::cout << "SPHL"; break;
-		case 0xfa:
-			std::cout << "JM     $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xfb:
-			std::cout << "EI"; break;
-		case 0xfc:
-			std::cout << "CM     $" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2] << std::setw(2) << std::setfill('0') << (int) memory[index+1];
-			opBytes = 3; break;
-		case 0xfd:
-			std::cout << "NOP"; break;
-		case 0xfe:
-			std::cout << "CPI    #$" << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			opBytes = 2; break;
-		case 0xff:
-			std::cout << "RST    7"; break;
 
+	//Operands line up in the column after the longest mnemonic
+	std::string text = info.mnemonic;
+	size_t space = text.find(' ');
+	std::string registers = space == std::string::npos ? "" : text.substr(space + 1);
+	text = text.substr(0, space);
+	if(!registers.empty() || info.format != OPERAND_NONE) {
+		text.resize(7, ' ');
+		text += registers;
+		if(!registers.empty() && info.format != OPERAND_NONE)
+			text += ",";
 	}
+	std::cout << text << std::setfill('0');
+	if(info.format == OPERAND_BYTE)
+		std::cout << "#$" << std::setw(2) << (int) byte2;
+	else if(info.format != OPERAND_NONE)
+		std::cout << (info.format == OPERAND_WORD ? "#$" : "$") << std::setw(4) << ((byte3 << 8) | byte2);
 
 	std::cout << "\n";
 
-	return opBytes;
+	return info.length;
 }
 
 int MachineState::getOpcodeDescription(uint16_t index) const {
-	unsigned char code = memory[index];
-	int opBytes = 1;
+	const OpcodeInfo& info = opcodes[memory[index]];
+	uint8_t byte2 = memory[(uint16_t) (index+1)], byte3 = memory[(uint16_t) (index+2)];
 	std::cout << std::hex << std::setw(4) << std::setfill('0') << index << " ";
-	switch(code)
-	{
-		case 0x01: //LXI B
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2];
-			std::cout << " moved into B, ";
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into C";
-			opBytes = 3; break;
-		case 0x02: //STAX B
-			std::cout << "Store A in location specified by BC"; break;
-		case 0x03: //INX B
-			std::cout << "BC++"; break;
-		case 0x04: //INR B
-			std::cout << "B++"; break;
-		case 0x05: //DCR B
-			std::cout << "B--"; break;
-		case 0x06: //MVI B
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into B";
-			opBytes = 2; break;
-		case 0x07: //RLC
-			std::cout << "A<<1, shifted off bit placed onto other end"; break;
-		case 0x09: //DAD B
-			std::cout << "HL += BC"; break;
-		case 0x0a: //LDAX B
-			std::cout << "A = memory[BC]"; break;
-		case 0x0b: //DCX B
-			std::cout << "BC--"; break;
-		case 0x0c: //INR C
-			std::cout << "C++"; break;
-		case 0x0d: //DCR C
-			std::cout << "C--"; break;
-		case 0x0e: //MVI C
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into C";
-			opBytes = 2; break;
-		case 0x0f: //RRC
-			std::cout << "A>>1, shifted off bit placed onto other end"; break;
-		case 0x11: //LXI D
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2];
-			std::cout << " moved into D, ";
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into E";
-			opBytes = 3; break;
-		case 0x12: //STAX D
-			std::cout << "Store A in location specified by DE"; break;
-		case 0x13: //INX D
-			std::cout << "DE++"; break;
-		case 0x14: //INR D
-			std::cout << "D++"; break;
-		case 0x15: //DCR D
-			std::cout << "D--"; break;
-		case 0x16: //MVI D
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into D";
-			opBytes = 2; break;
-		case 0x17: //RAL
-			std::cout << "A<<1, shifted off bit placed into carry, carry placed into other end"; break;
-		case 0x19: //DAD D
-			std::cout << "HL += DE"; break;
-		case 0x1a: //LDAX D
-			std::cout << "A = memory[DE]"; break;
-		case 0x1b: //DCX D
-			std::cout << "DE--"; break;
-		case 0x1c: //INR E
-			std::cout << "E++"; break;
-		case 0x1d: //DCR E
-			std::cout << "E--"; break;
-		case 0x1e: //MVI E
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into E";
-			opBytes = 2; break;
-		case 0x1f: //RAR
-			std::cout << "A>>1, shifted off bit placed into carry, carry placed into other end"; break;
-		case 0x21: //LXI H
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+2];
-			std::cout << " moved into H, ";
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into L";
-			opBytes = 3; break;
-		case 0x22: //SHLD
-			std::cout << "memory[(byte3)(byte2)] = L, memory[(byte3)(byte2)+1] = H";
-			opBytes = 3; break;
-		case 0x23: //INX H
-			std::cout << "HL++"; break;
-		case 0x24: //INR H
-			std::cout << "H++"; break;
-		case 0x25: //DRC H
-			std::cout << "H--"; break;
-		case 0x26: //MVI H
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into H";
-			opBytes = 2; break;
-		case 0x27: //DAA
-			std::cout << "Decimal Adjust Accumulator (check manual for details)"; break;
-		case 0x29: //DAD H
-			std::cout << "HL += HL"; break;
-		case 0x2a: //LHLD
-			std::cout << "L = memory[(byte3)(byte2)], H = memory[(byte3)(byte2)+1]";
-			opBytes = 3; break;
-		case 0x2b: //DCX H
-			std::cout << "HL--"; break;
-		case 0x2c: //INR L
-			std::cout << "L++"; break;
-		case 0x2d: //DCR L
-			std::cout << "L--"; break;
-		case 0x2e: //MVI L
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into L";
-			opBytes = 2; break;
-		case 0x2f: //CMA
-			std::cout << "~A (negate bits of A)"; break;
-		case 0x31: //LXI SP
-			std::cout << "SP = (byte3)(byte2)";
-			opBytes = 3; break;
-		case 0x32: //STA
-			std::cout << "memory[(byte3)(byte2)] = A";
-			opBytes = 3; break;
-		case 0x33: //INX SP
-			std::cout << "SP++"; break;
-		case 0x34: //INR M
-			std::cout << "memory[HL]++"; break;
-		case 0x35: //DCR M
-			std::cout << "memory[HL]--"; break;
-		case 0x36: //MVI M
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into memory[HL]";
-			opBytes = 2; break;
-		case 0x37: //STC
-			std::cout << "Carry flag = 1"; break;
-		case 0x39: //DAD SP
-			std::cout << "HL += SP"; break;
-		case 0x3a: //LDA
-			std::cout << "A = memory[(byte3)(byte2)]";
-			opBytes = 3; break;
-		case 0x3b: //DCX
-			std::cout << "SP--"; break;
-		case 0x3c: //INR A
-			std::cout << "A++"; break;
-		case 0x3d: //DCR A
-			std::cout << "A--"; break;
-		case 0x3e: //MVI
-			std::cout << std::setw(2) << std::setfill('0') << std::hex << (int) memory[index+1];
-			std::cout << " moved into A";
-			opBytes = 2; break;
-		case 0x3f: //CMC
-			std::cout << "carry bit *= -1"; break;
-		case 0x76: //HLT
-			std::cout << "PC increments to next insturction, then waits for interrupt"; break;
-		case 0xc0: //RNZ
-			std::cout << "Return if zero bit = 0"; break;
-		case 0xc1: //POP B
-			std::cout << "C = memory[SP], B = memory[SP+1], SP += 2"; break;
-		case 0xc2: //JNZ
-			std::cout << "Jump if zero bit = 0";
-			opBytes = 3; break;
-		case 0xc3: //JMP
-			std::cout << "Unconditional jump";
-			opBytes = 3; break;
-		case 0xc4: //CNZ
-			std::cout << "Call if zero bit = 0";
-			opBytes = 3; break;
-		case 0xc5: //PUSH B
-			std::cout << "memory[SP-1] = B, memory[SP-2] = C, SP -= 2"; break;
-		case 0xc7: //RST 0
-			std::cout << "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 0"; break;
-		case 0xc8: //RZ
-			std::cout << "Return if zero bit = 1"; break;
-		case 0xc9: //RET
-			std::cout << "Unconditional return"; break;
-		case 0xca: //JZ
-			std::cout << "Jump if zero bit = 1";
-			opBytes = 3; break;
-		case 0xcc: //CZ
-			std::cout << "Call if zero bit = 1";
-			opBytes = 3; break;
-		case 0xcd: //CALL
-			std::cout << "Unconditional Call, also special output for diagnostic";
-			opBytes = 3; break;
-		case 0xcf: //RST 1
-			std::cout << "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 8"; break;
-		case 0xd0: //RNC
-			std::cout << "Return if carry bit = 0"; break;
-		case 0xd1: //POP D
-			std::cout << "E = memory[SP], D = memory[SP+1], SP += 2"; break;
-		case 0xd2: //JNC
-			std::cout << "Jump if carry bit = 0";
-			opBytes = 3; break;
-		case 0xd4: //CNC
-			std::cout << "Call if carry bit = 0";
-			opBytes = 3; break;
-		case 0xd5: //PUSH D
-			std::cout << "memory[SP-1] = D, memory[SP-2] = E, SP -= 2"; break;
-		case 0xd7: //RST 2
-			std::cout << "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 16"; break;
-		case 0xd8: //RC
-			std::cout << "Return if carry bit = 1"; break;
-		case 0xda: //JC
-			std::cout << "Jump if carry bit = 1";
-			opBytes = 3; break;
-		case 0xdc: //CC
-			std::cout << "Call if carry bit = 1";
-			opBytes = 3; break;
-		case 0xdf: //RST 3
-			std::cout << "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 16"; break;
-		case 0xe0: //RPO
-			std::cout << "Return if parity bit = 0"; break;
-		case 0xe1: //POP H
-			std::cout << "L = memory[SP], H = memory[SP+1], SP += 2"; break;
-		case 0xe2: //JPO
-			std::cout << "Jump if parity bit = 0";
-			opBytes = 3; break;
-		case 0xe3: //XTHL
-			std::cout << "L <-> memory[SP], H <-> memory[SP+1]"; break;
-		case 0xe4: //CPO
-			std::cout << "Call if parity bit = 0";
-			opBytes = 3; break;
-		case 0xe5: //PUSH H
-			std::cout << "memory[SP-1] = H, memory[SP-2] = L, SP -= 2"; break;
-		case 0xe7: //RST 4
-			std::cout << "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 24"; break;
-		case 0xe8: //RPE
-			std::cout << "Return if parity bit = 1"; break;
-		case 0xe9: //PCHL
-			std::cout << "(PC highest 8 bits) = H, (PC lowest 8 bits) = L"; break;
-		case 0xea: //JPE
-			std::cout << "Jump if parity bit = 1";
-			opBytes = 3; break;
-		case 0xeb: //XCHG
-			std::cout << "H <-> D, L <-> E"; break;
-		case 0xec: //CPE
-			std::cout << "Call if parity bit = 1";
-			opBytes = 3; break;
-		case 0xee: //XRI
-			std::cout << "XOR with immediate";
-			opBytes = 2; break;
-		case 0xef: //RST 4
-			std::cout << "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 32"; break;
-		case 0xf0: //RP
-			std::cout << "Return if sign bit = 0"; break;
-		case 0xf1: //POP PSW
-			std::cout << "Take flag values off of stack"; break;
-		case 0xf2: //JP
-			std::cout << "Jump if sign bit = 0";
-			opBytes = 3; break;
-		case 0xf3: //DI
-			std::cout << "int_enable = 0"; break;
-		case 0xf4: //CP
-			std::cout << "Call if sign bit = 0";
-			opBytes = 3; break;
-		case 0xf5: //PUSH PSW
-			std::cout << "Push flags to stack"; break;
-		case 0xf6: //ORI
-			std::cout << "OR immediate";
-			opBytes = 2; break;
-		case 0xf7: //RST 6
-			std::cout << "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 48"; break;
-		case 0xf8: //RM
-			std::cout << "Return if sign bit = 1"; break;
-		case 0xf9: //SPHL
-			std::cout << "SP = HL"; break;
-		case 0xfa: //JM
-			std::cout << "Jump if sign bit = 1";
-			opBytes = 3; break;
-		case 0xfb: //EI
-			std::cout << "int_enable = 1"; break;
-		case 0xfc: //CM
-			std::cout << "Call if sign bit = 1";
-			opBytes = 3; break;
-		case 0xfe: //CPI
-			std::cout << "Compare immediate";
-			opBytes = 2; break;
-		case 0xff: //RST 7
-			std::cout << "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 56"; break;
+
+	for(const char* c = info.description; *c != 0; c++) {
+		if(c[0] == '%' && (c[1] == '1' || c[1] == '2')) {
+			std::cout << std::setw(2) << std::setfill('0') << (int) (c[1] == '1' ? byte2 : byte3);
+			c++;
+		}
+		else
+			std::cout << *c;
 	}
 
 	std::cout << "\n";
 
-	return opBytes;
+	return info.length;
 }
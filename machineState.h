@@ -1,40 +1,277 @@
 #ifndef machineState_h
 #define machineState_h
 
-#include <bitset>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "opcodes.h"
+#include "scheduler.h"
+
+//processCommands uses the engine picked at build time with -DDISPATCH_SWITCH,
+//-DDISPATCH_TABLE, -DDISPATCH_THREADED or -DDISPATCH_CACHED, defaulting to threaded where the
+//compiler supports computed goto and to the handler table otherwise
+#if defined(__GNUC__)
+#define HAVE_COMPUTED_GOTO
+#endif
+#if defined(DISPATCH_THREADED) && !defined(HAVE_COMPUTED_GOTO)
+#error "DISPATCH_THREADED requires computed goto support"
+#endif
+
+//runJit translates hot blocks to x86-64 code, -DDISPATCH_JIT makes it the default engine
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define HAVE_JIT
+#endif
+#if defined(DISPATCH_JIT) && !defined(HAVE_JIT)
+#error "DISPATCH_JIT requires an x86-64 unix host"
+#endif
+
+//-DLAZY_FLAGS defers computing Z, S, P and AC until an instruction or
+//printState actually reads them
+
+//Attributes of each 256 byte page of the address space, plain RAM has none
+enum PageFlag : uint8_t {
+	PAGE_CODE = 0x01,	//holds cached blocks that stores must invalidate
+	PAGE_ROM = 0x02,	//stores are ignored
+	PAGE_MIRROR = 0x04,	//shares its bytes with other pages
+	PAGE_DEVICE = 0x08,	//loads and stores go to a MemoryDevice
+	PAGE_WATCHED = 0x10,	//stores mark their line dirty
+	PAGE_SHARED = 0x20,	//unchanged since the last snapshot or restore
+	PAGE_WATCHPOINT = 0x40	//stores are checked against the watchpoint
+};
+
+//Hardware that answers loads and stores on the pages given to mapDevice,
+//address is the full 16 bit address
+class MemoryDevice {
+public:
+	virtual ~MemoryDevice() {}
+	virtual uint8_t read(uint16_t address) = 0;
+	virtual void write(uint16_t address, uint8_t value) = 0;
+};
+
+//Hardware on the IN and OUT ports given to mapInputPort and mapOutputPort.
+//The base class is what unmapped ports see, reads give 0 and writes are dropped.
+class PortDevice {
+public:
+	virtual ~PortDevice() {}
+	virtual uint8_t in(uint8_t) { return 0; }
+	virtual void out(uint8_t, uint8_t) {}
+};
+
+class JitBuffer;
+class ShiftRegister;
+
 class MachineState {
 public:
 	MachineState(const std::string& fileName);
+	MachineState(const std::vector<uint8_t>& image, uint16_t origin); //Raw binary placed at origin
+	MachineState(const MachineState&) = delete;
+	MachineState& operator=(const MachineState&) = delete;
 	~MachineState();
 
 	void printState() const;
 	void printDisassembled() const;
 	bool isDone() const { return pc >= memorySize; }
+	bool isHalted() const { return halted; }
+	uint16_t getPC() const { return pc; }
+	const uint8_t* getMemory() const { return memory; } //The full 64K address space
 
 	void processCommand();
+	void processCommands(uint64_t count);
+	uint64_t run(uint64_t cycles); //Runs for at least cycles clock cycles, returns the cycles used
+	uint64_t runInstruction(); //Runs one instruction the way run would, returns the cycles used
+	uint64_t cycleCount() const { return cycles; }
+	bool interrupt(uint8_t number); //RST number if interrupts are enabled, also ends a HLT
+	Scheduler& scheduler() { return events; } //Events run fires as their cycle comes up
+	void setIdleSkip(bool enabled) { idleSkip = enabled; } //Lets run skip polling loops
+
+	//Memory map, start and size have to be multiples of the 256 byte page
+	//size. Everything starts out as RAM, code can't run from device pages.
+	void mapRAM(uint16_t start, uint32_t size);
+	void mapROM(uint16_t start, uint32_t size);
+	void mapMirror(uint16_t start, uint32_t size, uint16_t target);
+	void mapDevice(uint16_t start, uint32_t size, MemoryDevice* device);
+
+	//Stores to watched pages count up watchedWrites and stamp the count on the
+	//DIRTY_LINE_SIZE byte line they land in, so any number of readers can find
+	//the lines written since the count they last saw. A line is one Space
+	//Invaders screen column. Mapping the pages again keeps the watch, but
+	//stores that ROM ignores or a device takes aren't counted.
+	static const unsigned int DIRTY_LINE_SIZE = 32;
+	void watchWrites(uint16_t start, uint32_t size, bool enabled = true);
+	uint64_t watchedWrites() const { return writeCount; }
+	uint64_t lineWritten(uint16_t address) const { return lineWrites[address / DIRTY_LINE_SIZE]; }
+
+	//Every store to the watchpoint, from any instruction or interrupt, counts
+	//up watchpointHits, so a debugger stepping through can tell exactly which
+	//instruction wrote it. Only stores to the watchpoint's page are checked.
+	void setWatchpoint(int address); //-1 for none
+	uint64_t watchpointHits() const { return watchpointStores; }
+
+	//Everything a running program can change: registers, memory, the cycle
+	//count, pending events and the shift register. Memory pages are shared,
+	//read only, between snapshots and the machine they came from, and the
+	//first store to a page after a snapshot or restore is what marks it for
+	//copying. Taking a snapshot or restoring one costs a page copy per page
+	//written since the last one, not 64K, so forking many runs from one state
+	//is cheap. Restoring into another machine with the same memory map works
+	//too, but events still act on whatever their actions captured.
+	typedef std::array<uint8_t, 0x100> Page;
+	struct Snapshot {
+		std::shared_ptr<const Page> pages[256]; //nullptr for device pages
+		uint16_t psw, bc, de, hl, sp, pc;
+		uint8_t intEnable;
+		bool halted;
+		uint64_t cycles;
+		uint32_t memorySize;
+		Scheduler events;
+		uint16_t shiftValue = 0;
+		uint8_t shiftOffset = 0;
+	};
+	Snapshot snapshot();
+	void restore(const Snapshot& snapshot);
+
+	//The same state in a file laid out as in saveState.h. Loading reads and
+	//checks the whole file before changing anything. Events are moved to their
+	//saved times rather than created, so the loading machine needs the same
+	//ones scheduled. False, leaving the machine as it was, when the file can't
+	//be written or read, isn't a save state of this version or the events differ.
+	bool saveState(const std::string& fileName) const;
+	bool loadState(const std::string& fileName);
+
+	//I/O ports, one device per port and direction. nullptr puts a port back
+	//on the default device, which setDefaultPorts replaces for every such port.
+	void mapInputPort(uint8_t port, PortDevice* device);
+	void mapOutputPort(uint8_t port, PortDevice* device);
+	void setDefaultPorts(PortDevice* device);
+	void mapShiftRegister(ShiftRegister* device); //Maps its three ports, IN and OUT call it inline
+
+	//Individual dispatch engines, each runs exactly count instructions
+	void runSwitch(uint64_t count);
+	void runTable(uint64_t count);
+#ifdef HAVE_COMPUTED_GOTO
+	void runThreaded(uint64_t count);
+#endif
+	void runCached(uint64_t count);
+#ifdef HAVE_JIT
+	void runJit(uint64_t count);
+#endif
 
 private:
-	//Reigsters and other data to store
-	uint8_t a, b, c, d, e, h, l;
+	//Reigsters and other data to store. BC, DE, HL and PSW are 16 bit pairs
+	//with their two 8 bit registers laid over the high and low byte.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define REGISTER_PAIR(pair, high, low) union { uint16_t pair; struct { uint8_t high, low; }; }
+#else
+#define REGISTER_PAIR(pair, high, low) union { uint16_t pair; struct { uint8_t low, high; }; }
+#endif
+	REGISTER_PAIR(psw, a, f); //f holds the condition codes, see Flag
+	REGISTER_PAIR(bc, b, c);
+	REGISTER_PAIR(de, d, e);
+	REGISTER_PAIR(hl, h, l);
+#undef REGISTER_PAIR
 	uint16_t sp, pc;
-	unsigned char* memory;
-	uint16_t memorySize;
+	unsigned char* memory; //The full 64K address space
+	uint32_t memorySize; //End of the loaded image
 	uint8_t int_enable;
-	uint8_t shift0, shift1, shift_offset;
-	/*Condition Code reference
-	0 = z = zero
-	1 = s = sign
-	2 = p = parity
-	3 = cy = carry
-	4 = ac = auxillary carry
-	*/
-	std::bitset<5> cc;
+	bool halted = false;
+	bool idleSkip = false;
+	Scheduler events;
+	uint64_t cycles = 0; //Clock cycles executed since power on
+#ifdef LAZY_FLAGS
+	//Last flag setting ALU operation, LAZY_NONE once f holds every flag
+	enum LazyOp : uint8_t { LAZY_NONE, LAZY_ADD, LAZY_LOGIC };
+	LazyOp lazyOp;
+	uint8_t lazyResult, lazyLeft, lazyRight;
+#endif
+
+	bool flag(uint8_t mask) const;
+	uint8_t flags() const;
+	void setFlags(uint8_t value);
+	void setAddFlags(uint8_t result, uint8_t left, uint8_t right, uint8_t carry);
+	void setLogicFlags(uint8_t result, uint8_t acBits);
+
+	//One handler per opcode, called with pc already past the opcode byte
+	template<uint8_t OP> void exec();
+	template<uint8_t OP> static void step(MachineState& state) { state.cycles += opcodes[OP].cycles; state.exec<OP>(); }
+	template<uint8_t R> uint8_t& reg();
+	template<uint8_t R> uint8_t load();
+	template<uint8_t R> void store(uint8_t value);
+	template<uint8_t OPERATION> void alu(uint8_t value);
+	typedef void (*OpHandler)(MachineState&);
+	static const OpHandler opTable[256];
+	static const uint8_t MAX_OP_CYCLES = maxOpCycles();
+	void takenCycles();
+	static const unsigned int IDLE_LOOP_OPS = 8; //Longest loop idleLoop recognises
+	static const uint64_t IDLE_CHECK_OPS = 256; //Instructions between idle checks
+	bool idleLoop();
+
+	//Predecoded straight line code for runCached, keyed by start address
+	static const unsigned int MAX_BLOCK_OPS = 64;
+	struct Block {
+#ifdef HAVE_COMPUTED_GOTO
+		std::vector<const void*> ops; //Handler labels inside runCached
+#else
+		std::vector<OpHandler> ops;
+#endif
+		uint16_t length; //Bytes of code covered
+#ifdef HAVE_JIT
+		typedef uint32_t (*NativeCode)(MachineState*); //Returns the instructions it ran
+		NativeCode native = nullptr;
+		uint32_t nativeOps = 0;
+		uint32_t runs = 0;
+#endif
+	};
+#ifdef HAVE_COMPUTED_GOTO
+	static const void* const* cachedLabels;
+#endif
+	std::vector<std::unique_ptr<Block>> blocks;
+	std::vector<uint16_t> pageBlocks[256]; //Start of every block touching each 256 byte page
+	std::vector<std::unique_ptr<Block>> retiredBlocks;
+	bool blockInvalidated = false;
+	Block* decodeBlock(uint16_t start);
+	void invalidateCode(uint16_t address);
+	void invalidatePage(uint8_t page);
+	void flushBlocks();
+	uint8_t readMemory(uint16_t address);
+	void writeMemory(uint16_t address, uint8_t value);
+
+#ifdef HAVE_JIT
+	static const size_t JIT_BUFFER_SIZE = 4 << 20;
+	std::unique_ptr<JitBuffer> jit;
+	bool compileBlock(Block* block, uint16_t start);
+#endif
+
+	//IN and OUT go straight to the device in these tables
+	PortDevice* inputPorts[256];
+	PortDevice* outputPorts[256];
+	PortDevice noPorts;
+	PortDevice* defaultPorts = &noPorts;
+	ShiftRegister* shiftRegister = nullptr;
+
+	//Memory map, each page with no flags is plain RAM
+	uint8_t pageFlags[256] = {}; //See PageFlag
+	uint8_t pageTarget[256]; //Page a PAGE_MIRROR page copies
+	std::vector<uint8_t> mirrors[256]; //Pages copying each mirrored page
+	MemoryDevice* pageDevice[256] = {};
+	unsigned int devicePages = 0;
+	uint64_t writeCount = 0;
+	uint64_t lineWrites[0x10000 / DIRTY_LINE_SIZE] = {}; //writeCount after the last store to each line
+	std::shared_ptr<const Page> basePages[256]; //What each PAGE_SHARED page still holds
+	int watchpoint = -1;
+	uint64_t watchpointStores = 0;
+	void mapPages(uint16_t start, uint32_t size, uint8_t flags);
+	void pageReplaced(uint8_t page);
+	void writeMapped(uint16_t address, uint8_t value);
+	void storeTracked(uint16_t address, uint8_t value);
 
 	//Helper commands for certian opcodes
 	void sub(uint8_t num, uint8_t carry);
 	void add(uint8_t num, uint16_t carry);
+	uint8_t inr(uint8_t num);
+	uint8_t dcr(uint8_t num);
 	void call(bool condition);
 	void ret(bool condition);
 	void ana(uint8_t num);
@@ -43,11 +280,9 @@ private:
 	void cmp(uint8_t num);
 	void dad(uint16_t num);
 	void rst(uint8_t num);
-	uint8_t MachineIN();
-	void MachineOUT();
 
 	int getOpcode(uint16_t index) const;
 	int getOpcodeDescription(uint16_t index) const;
 };
 
-#endif
\ No newline at end of file
+#endif
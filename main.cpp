@@ -1,38 +1,355 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include "machineState.h"
+#include "debugger.h"
+#include "framePipeline.h"
+#include "shiftRegister.h"
+#include "throttle.h"
+#include "video.h"
 
-int main(int argc, char* argv[]) {
+//Instructions run between checks for a halt in batch mode
+static const uint64_t BATCH_SIZE = 10000;
+
+//Space Invaders runs at 2 MHz with a 60 Hz screen, interrupting with RST 1
+//when the beam reaches the middle of the screen and RST 2 at the bottom
+static const uint64_t CLOCK_HZ = 2000000;
+static const uint64_t CYCLES_PER_FRAME = CLOCK_HZ / 60;
+
+//Most instructions c runs looking for a breakpoint
+static const uint64_t CONTINUE_LIMIT = 100000000;
+static const char* const COMMANDS = "Commands: N, b [N], c, rc, bp ADDR, w ADDR";
+
+static void usage(const char* program) {
+	std::cerr << "Usage: " << program << " file [-d]\n"
+				<< "       " << program << " file [--run-until-halt] [--max-instructions N] [--until-pc ADDR] [--quiet]\n"
+				<< "       " << program << " file --frames N [--dump-frames PREFIX] [--indexed] [--pipeline] [--realtime]\n"
+				<< "Adding --origin ADDR (hex) to any of them loads the file as a raw image at ADDR, and\n"
+				<< "--load-state FILE starts any but -d from a save state, which --save-state FILE writes\n"
+				<< "after a batch or frame run" << std::endl;
+	exit(1);
+}
+
+//A whole argument in base 10 or 16, false if any of it isn't a digit or it
+//doesn't fit in max
+static bool parseNumber(const std::string& text, int base, uint64_t max, uint64_t& value) {
+	if(text.empty() || !std::isxdigit((unsigned char) text[0]))
+		return false;
+	char* end;
+	errno = 0;
+	value = std::strtoull(text.c_str(), &end, base);
+	return *end == '\0' && errno == 0 && value <= max;
+}
+
+//Runs without any console I/O until a stop condition is hit, then prints the
+//final state and the speed
+static void runBatch(MachineState& state, bool untilHalt, uint64_t maxInstructions, int untilPC, bool quiet) {
+	uint64_t executed = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	while(executed < maxInstructions && !state.isDone() && !(untilHalt && state.isHalted())) {
+		if(untilPC >= 0) {
+			//Stepping one at a time is the only way to stop exactly on the address,
+			//through the build's engine so the numbers are that engine's
+			if(state.getPC() == untilPC)
+				break;
+			state.processCommands(1);
+			executed++;
+		}
+		else {
+			uint64_t batch = std::min(BATCH_SIZE, maxInstructions - executed);
+			state.processCommands(batch);
+			executed += batch;
+		}
+	}
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	if(!quiet)
+		state.printState();
+	if(state.isHalted())
+		std::cout << "Halted\n";
+	std::cout << std::dec << executed << " instructions, " << state.cycleCount() << " cycles in "
+				<< elapsed.count() << " s, " << executed / elapsed.count() / 1e6 << " MIPS" << std::endl;
+}
+
+static void dumpFrame(const Video& video, const std::string& prefix, uint64_t frame) {
+	char number[24];
+	snprintf(number, sizeof(number), "%05llu", (unsigned long long)frame);
+	if(!video.savePPM(prefix + number + ".ppm")) {
+		std::cerr << "Could not write " << prefix + number + ".ppm" << std::endl;
+		exit(1);
+	}
+}
+
+//Puts the machine in the save state if one was given, once any events it
+//needs are scheduled
+static void loadState(MachineState& state, const std::string& fileName) {
+	if(!fileName.empty() && !state.loadState(fileName)) {
+		std::cerr << "Could not load the save state " << fileName << std::endl;
+		exit(1);
+	}
+}
+
+static void saveState(const MachineState& state, const std::string& fileName) {
+	if(!fileName.empty() && !state.saveState(fileName)) {
+		std::cerr << "Could not write the save state " << fileName << std::endl;
+		exit(1);
+	}
+}
+
+//How closely a realtime run kept to the clock
+static void printPacing(const Throttle& throttle, bool realtime, std::chrono::duration<double> elapsed) {
+	if(realtime)
+		std::cout << std::dec << elapsed.count() << " s real time, " << throttle.late() << " frames late, "
+					<< throttle.restarts() << " clock restarts" << std::endl;
+}
+
+//Runs whole video frames with the screen interrupts, bringing the picture up
+//to date after each one and writing it to PREFIX00000.ppm and up when a
+//prefix is given. Turbo by default, realtime sleeps after each frame until the
+//wall clock has caught up with the 2 MHz clock.
+static void runFrames(MachineState& state, uint64_t frames, const std::string& dumpPrefix, Video::Format format, bool realtime,
+						const std::string& stateFile) {
+	Video video(format);
+	Throttle throttle(CLOCK_HZ);
+	state.scheduler().every(CYCLES_PER_FRAME / 2, CYCLES_PER_FRAME, [&state] { state.interrupt(1); });
+	state.scheduler().every(CYCLES_PER_FRAME, CYCLES_PER_FRAME, [&state] { state.interrupt(2); });
+	loadState(state, stateFile);
+
+	std::chrono::duration<double> emulating(0), rendering(0);
+	uint64_t changed = 0;
+	auto began = std::chrono::steady_clock::now();
+	throttle.start(state.cycleCount());
+	for(uint64_t frame = 0; frame < frames; frame++) {
+		auto start = std::chrono::steady_clock::now();
+		state.run(CYCLES_PER_FRAME);
+		auto rendered = std::chrono::steady_clock::now();
+		if(video.update(state))
+			changed++;
+		auto end = std::chrono::steady_clock::now();
+		emulating += rendered - start;
+		rendering += end - rendered;
+
+		if(!dumpPrefix.empty())
+			dumpFrame(video, dumpPrefix, frame);
+		if(realtime)
+			throttle.wait(state.cycleCount());
+	}
 
-	if(argc < 2 || argc > 3) {
-		std::cerr << "Incorrect number of arguments" << std::endl;
+	std::cout << std::dec << frames << " frames (" << changed << " changed), " << state.cycleCount() << " cycles, "
+				<< emulating.count() / frames * 1e6 << " us emulating and " << rendering.count() / frames * 1e6
+				<< " us rendering (" << video.kernelName() << ") per frame" << std::endl;
+	printPacing(throttle, realtime, std::chrono::steady_clock::now() - began);
+}
+
+//Like runFrames, but VRAM is copied out at every vblank and converted and
+//saved on a second thread while the CPU carries on. Frames the other thread
+//hasn't got to when the ring is full are dropped.
+static void runPipelined(MachineState& state, uint64_t frames, const std::string& dumpPrefix, Video::Format format, bool realtime,
+							const std::string& stateFile) {
+	Video video(format);
+	Throttle throttle(CLOCK_HZ);
+	FramePipeline pipeline;
+	pipeline.start([&video, &dumpPrefix](const FramePipeline::Frame& frame) {
+		video.render(frame.vram);
+		if(!dumpPrefix.empty())
+			dumpFrame(video, dumpPrefix, frame.number);
+	});
+	state.scheduler().every(CYCLES_PER_FRAME / 2, CYCLES_PER_FRAME, [&state] { state.interrupt(1); });
+	state.scheduler().every(CYCLES_PER_FRAME, CYCLES_PER_FRAME, [&state, &pipeline] {
+		pipeline.publish(state);
+		state.interrupt(2);
+	});
+	loadState(state, stateFile);
+
+	std::chrono::duration<double> emulating(0);
+	auto began = std::chrono::steady_clock::now();
+	throttle.start(state.cycleCount());
+	for(uint64_t frame = 0; frame < frames; frame++) {
+		auto start = std::chrono::steady_clock::now();
+		state.run(CYCLES_PER_FRAME);
+		emulating += std::chrono::steady_clock::now() - start;
+		if(realtime)
+			throttle.wait(state.cycleCount());
+	}
+	pipeline.stop();
+
+	std::cout << std::dec << pipeline.published() << " frames converted, " << pipeline.dropped() << " dropped, "
+				<< state.cycleCount() << " cycles, " << emulating.count() / frames * 1e6 << " us emulating per frame" << std::endl;
+	printPacing(throttle, realtime, std::chrono::steady_clock::now() - began);
+}
+
+//One line of the interactive mode. A number, or nothing for 1, runs that
+//many instructions and b [N] undoes them. c and rc run forward or back to a
+//breakpoint, bp ADDR sets or clears one and w ADDR finds the last store to
+//ADDR, addresses in hex. False when told to run on from a halt.
+static bool debugCommand(Debugger& debugger, const MachineState& state, const std::string& line) {
+	std::istringstream words(line);
+	std::string command, argument;
+	words >> command >> argument;
+	const bool forward = command.empty() || (command[0] >= '0' && command[0] <= '9') || command == "c";
+	if(forward && state.isHalted())
+		return false;
+
+	uint64_t number = 1;
+	if(command.empty())
+		debugger.step(1);
+	else if(command[0] >= '0' && command[0] <= '9' && parseNumber(command, 10, UINT64_MAX, number))
+		debugger.step(number);
+	else if(command == "b" && (argument.empty() || parseNumber(argument, 10, UINT64_MAX, number))) {
+		if(debugger.stepBack(number) < number)
+			std::cout << "Reached the oldest checkpoint" << std::endl;
+	}
+	else if(command == "c") {
+		if(!debugger.continueForward(CONTINUE_LIMIT))
+			std::cout << "No breakpoint reached" << std::endl;
+	}
+	else if(command == "rc") {
+		if(!debugger.reverseContinue())
+			std::cout << "No breakpoint since the oldest checkpoint" << std::endl;
+	}
+	else if(command == "bp" && parseNumber(argument, 16, 0xffff, number)) {
+		const uint16_t address = number;
+		std::cout << "Breakpoint " << (debugger.toggleBreakpoint(address) ? "set" : "cleared") << " at "
+					<< std::hex << address << std::endl;
+	}
+	else if(command == "w" && parseNumber(argument, 16, 0xffff, number)) {
+		const uint16_t address = number;
+		uint64_t cycle;
+		uint16_t pc;
+		if(debugger.lastWrite(address, cycle, pc))
+			std::cout << std::hex << address << " last written on cycle " << std::dec << cycle
+						<< " by the instruction at " << std::hex << pc << std::endl;
+		else
+			std::cout << std::hex << address << " not written since the oldest checkpoint" << std::endl;
+	}
+	else
+		std::cout << COMMANDS << std::endl;
+	return true;
+}
+
+//Raw image without the 0x100 byte CP/M offset the file constructor adds
+static std::vector<uint8_t> readImage(const std::string& fileName) {
+	std::ifstream input(fileName, std::ios::in | std::ios::binary);
+	if(!input) {
+		std::cerr << "Could not open " << fileName << std::endl;
 		exit(1);
 	}
+	return std::vector<uint8_t>(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char* argv[]) {
+
+	if(argc < 2)
+		usage(argv[0]);
 
 	const std::string fileName = argv[1];
 
-	MachineState state(fileName);
+	bool disassemble = false, batch = false, untilHalt = false, quiet = false, pipelined = false, realtime = false;
+	uint64_t maxInstructions = UINT64_MAX, frames = 0;
+	int untilPC = -1, origin = -1;
+	uint64_t number;
+	std::string dumpPrefix, loadFile, saveFile;
+	Video::Format format = Video::FORMAT_RGBA;
+	for(int i = 2; i < argc; i++) {
+		const std::string arg = argv[i];
+		if(arg == "-d")
+			disassemble = true;
+		else if(arg == "--run-until-halt")
+			untilHalt = batch = true;
+		else if(arg == "--max-instructions" && i + 1 < argc && parseNumber(argv[i + 1], 10, UINT64_MAX, maxInstructions)) {
+			i++;
+			batch = true;
+		}
+		else if(arg == "--until-pc" && i + 1 < argc && parseNumber(argv[i + 1], 16, 0xffff, number)) {
+			untilPC = number;
+			i++;
+			batch = true;
+		}
+		else if(arg == "--quiet")
+			quiet = batch = true;
+		else if(arg == "--frames" && i + 1 < argc && parseNumber(argv[i + 1], 10, UINT64_MAX, frames))
+			i++;
+		else if(arg == "--dump-frames" && i + 1 < argc)
+			dumpPrefix = argv[++i];
+		else if(arg == "--indexed")
+			format = Video::FORMAT_INDEXED;
+		else if(arg == "--pipeline")
+			pipelined = true;
+		else if(arg == "--realtime")
+			realtime = true;
+		else if(arg == "--load-state" && i + 1 < argc)
+			loadFile = argv[++i];
+		else if(arg == "--save-state" && i + 1 < argc)
+			saveFile = argv[++i];
+		else if(arg == "--origin" && i + 1 < argc && parseNumber(argv[i + 1], 16, 0xffff, number)) {
+			origin = number;
+			i++;
+		}
+		else
+			usage(argv[0]);
+	}
+	if(disassemble && (batch || quiet || !loadFile.empty()))
+		usage(argv[0]);
+	if(!saveFile.empty() && !batch && frames == 0)
+		usage(argv[0]);
+	if(frames > 0 ? disassemble || batch : !dumpPrefix.empty() || format != Video::FORMAT_RGBA || pipelined || realtime)
+		usage(argv[0]);
+
+	std::unique_ptr<MachineState> loaded(origin >= 0 ? new MachineState(readImage(fileName), origin)
+													: new MachineState(fileName));
+	MachineState& state = *loaded;
+	ShiftRegister shiftRegister;
+	state.mapShiftRegister(&shiftRegister);
 
-	if(argc == 3 && (std::string) argv[2] == "-d") {
+	if(disassemble) {
 		state.printDisassembled();
 	}
 
+	else if(batch) {
+		loadState(state, loadFile);
+		runBatch(state, untilHalt, maxInstructions, untilPC, quiet);
+		saveState(state, saveFile);
+		return 0;
+	}
+
+	else if(frames > 0) {
+		if(pipelined)
+			runPipelined(state, frames, dumpPrefix, format, realtime, loadFile);
+		else
+			runFrames(state, frames, dumpPrefix, format, realtime, loadFile);
+		saveState(state, saveFile);
+		return 0;
+	}
+
 	else {
+		loadState(state, loadFile);
+		//A halted CPU can still be taken back, running on from it ends the session
+		Debugger debugger(state);
+		std::string line;
 		while(!state.isDone()) {
 			state.printState();
-			std::string input;
-			int numCommands = 1;
-			std::getline(std::cin, input);
-			if(input.length() > 0 && input[0] >= '0' && input[0] <= '9')
-				numCommands = std::stoi(input);
-			for(int i = 0; i < numCommands; i++)
-				state.processCommand();
+			if(state.isHalted())
+				std::cout << "Halted" << std::endl;
+			if(!std::getline(std::cin, line) || !debugCommand(debugger, state, line))
+				return 0;
 		}
 	}
 
 	std::cout << "End of memory reached" << std::endl;
-	
+
 	return 0;
 
-}
\ No newline at end of file
+}
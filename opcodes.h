@@ -0,0 +1,305 @@
+#ifndef opcodes_h
+#define opcodes_h
+
+#include <cstdint>
+
+//Flag bits as laid out in the PSW byte pushed by PUSH PSW
+enum Flag : uint8_t {
+	FLAG_CY = 0x01,	//carry
+	FLAG_P = 0x04,	//parity
+	FLAG_AC = 0x10,	//auxillary carry
+	FLAG_Z = 0x40,	//zero
+	FLAG_S = 0x80,	//sign
+	FLAG_MASK = 0xd5,
+	FLAG_SZAP = 0xd4	//Everything but carry, as INR and DCR set
+};
+
+//What follows the opcode byte, and how the disassembler shows it
+enum OperandFormat : uint8_t {
+	OPERAND_NONE,
+	OPERAND_BYTE,	//#$xx
+	OPERAND_WORD,	//#$xxxx
+	OPERAND_ADDRESS	//$xxxx
+};
+
+//Everything known about an opcode before running it. Conditional calls and
+//returns take cycles when not taken and takenCycles when taken, the two are
+//the same for every other opcode. %1 and %2 in description stand for the
+//first and second byte after the opcode.
+struct OpcodeInfo {
+	const char* mnemonic;
+	OperandFormat format;
+	uint8_t length;
+	uint8_t cycles;
+	uint8_t takenCycles;
+	uint8_t flagsRead;
+	uint8_t flagsWritten;
+	bool endsBlock; //Jumps, calls, returns, RST and HLT
+	const char* description;
+};
+
+constexpr OpcodeInfo opcodes[256] = {
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0x00
+	{"LXI B", OPERAND_WORD, 3, 10, 10, 0, 0, false, "%2 moved into B, %1 moved into C"},	//0x01
+	{"STAX B", OPERAND_NONE, 1, 7, 7, 0, 0, false, "Store A in location specified by BC"},	//0x02
+	{"INX B", OPERAND_NONE, 1, 5, 5, 0, 0, false, "BC++"},	//0x03
+	{"INR B", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "B++"},	//0x04
+	{"DCR B", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "B--"},	//0x05
+	{"MVI B", OPERAND_BYTE, 2, 7, 7, 0, 0, false, "%1 moved into B"},	//0x06
+	{"RLC", OPERAND_NONE, 1, 4, 4, 0, FLAG_CY, false, "A<<1, shifted off bit placed onto other end"},	//0x07
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0x08
+	{"DAD B", OPERAND_NONE, 1, 10, 10, 0, FLAG_CY, false, "HL += BC"},	//0x09
+	{"LDAX B", OPERAND_NONE, 1, 7, 7, 0, 0, false, "A = memory[BC]"},	//0x0a
+	{"DCX B", OPERAND_NONE, 1, 5, 5, 0, 0, false, "BC--"},	//0x0b
+	{"INR C", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "C++"},	//0x0c
+	{"DCR C", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "C--"},	//0x0d
+	{"MVI C", OPERAND_BYTE, 2, 7, 7, 0, 0, false, "%1 moved into C"},	//0x0e
+	{"RRC", OPERAND_NONE, 1, 4, 4, 0, FLAG_CY, false, "A>>1, shifted off bit placed onto other end"},	//0x0f
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0x10
+	{"LXI D", OPERAND_WORD, 3, 10, 10, 0, 0, false, "%2 moved into D, %1 moved into E"},	//0x11
+	{"STAX D", OPERAND_NONE, 1, 7, 7, 0, 0, false, "Store A in location specified by DE"},	//0x12
+	{"INX D", OPERAND_NONE, 1, 5, 5, 0, 0, false, "DE++"},	//0x13
+	{"INR D", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "D++"},	//0x14
+	{"DCR D", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "D--"},	//0x15
+	{"MVI D", OPERAND_BYTE, 2, 7, 7, 0, 0, false, "%1 moved into D"},	//0x16
+	{"RAL", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_CY, false, "A<<1, shifted off bit placed into carry, carry placed into other end"},	//0x17
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0x18
+	{"DAD D", OPERAND_NONE, 1, 10, 10, 0, FLAG_CY, false, "HL += DE"},	//0x19
+	{"LDAX D", OPERAND_NONE, 1, 7, 7, 0, 0, false, "A = memory[DE]"},	//0x1a
+	{"DCX D", OPERAND_NONE, 1, 5, 5, 0, 0, false, "DE--"},	//0x1b
+	{"INR E", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "E++"},	//0x1c
+	{"DCR E", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "E--"},	//0x1d
+	{"MVI E", OPERAND_BYTE, 2, 7, 7, 0, 0, false, "%1 moved into E"},	//0x1e
+	{"RAR", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_CY, false, "A>>1, shifted off bit placed into carry, carry placed into other end"},	//0x1f
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0x20
+	{"LXI H", OPERAND_WORD, 3, 10, 10, 0, 0, false, "%2 moved into H, %1 moved into L"},	//0x21
+	{"SHLD", OPERAND_ADDRESS, 3, 16, 16, 0, 0, false, "memory[(byte3)(byte2)] = L, memory[(byte3)(byte2)+1] = H"},	//0x22
+	{"INX H", OPERAND_NONE, 1, 5, 5, 0, 0, false, "HL++"},	//0x23
+	{"INR H", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "H++"},	//0x24
+	{"DCR H", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "H--"},	//0x25
+	{"MVI H", OPERAND_BYTE, 2, 7, 7, 0, 0, false, "%1 moved into H"},	//0x26
+	{"DAA", OPERAND_NONE, 1, 4, 4, FLAG_AC | FLAG_CY, FLAG_MASK, false, "Decimal Adjust Accumulator (check manual for details)"},	//0x27
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0x28
+	{"DAD H", OPERAND_NONE, 1, 10, 10, 0, FLAG_CY, false, "HL += HL"},	//0x29
+	{"LHLD", OPERAND_ADDRESS, 3, 16, 16, 0, 0, false, "L = memory[(byte3)(byte2)], H = memory[(byte3)(byte2)+1]"},	//0x2a
+	{"DCX H", OPERAND_NONE, 1, 5, 5, 0, 0, false, "HL--"},	//0x2b
+	{"INR L", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "L++"},	//0x2c
+	{"DCR L", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "L--"},	//0x2d
+	{"MVI L", OPERAND_BYTE, 2, 7, 7, 0, 0, false, "%1 moved into L"},	//0x2e
+	{"CMA", OPERAND_NONE, 1, 4, 4, 0, 0, false, "~A (negate bits of A)"},	//0x2f
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0x30
+	{"LXI SP", OPERAND_WORD, 3, 10, 10, 0, 0, false, "SP = (byte3)(byte2)"},	//0x31
+	{"STA", OPERAND_ADDRESS, 3, 13, 13, 0, 0, false, "memory[(byte3)(byte2)] = A"},	//0x32
+	{"INX SP", OPERAND_NONE, 1, 5, 5, 0, 0, false, "SP++"},	//0x33
+	{"INR M", OPERAND_NONE, 1, 10, 10, 0, FLAG_SZAP, false, "memory[HL]++"},	//0x34
+	{"DCR M", OPERAND_NONE, 1, 10, 10, 0, FLAG_SZAP, false, "memory[HL]--"},	//0x35
+	{"MVI M", OPERAND_BYTE, 2, 10, 10, 0, 0, false, "%1 moved into memory[HL]"},	//0x36
+	{"STC", OPERAND_NONE, 1, 4, 4, 0, FLAG_CY, false, "Carry flag = 1"},	//0x37
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0x38
+	{"DAD SP", OPERAND_NONE, 1, 10, 10, 0, FLAG_CY, false, "HL += SP"},	//0x39
+	{"LDA", OPERAND_ADDRESS, 3, 13, 13, 0, 0, false, "A = memory[(byte3)(byte2)]"},	//0x3a
+	{"DCX SP", OPERAND_NONE, 1, 5, 5, 0, 0, false, "SP--"},	//0x3b
+	{"INR A", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "A++"},	//0x3c
+	{"DCR A", OPERAND_NONE, 1, 5, 5, 0, FLAG_SZAP, false, "A--"},	//0x3d
+	{"MVI A", OPERAND_BYTE, 2, 7, 7, 0, 0, false, "%1 moved into A"},	//0x3e
+	{"CMC", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_CY, false, "carry bit *= -1"},	//0x3f
+	{"MOV B,B", OPERAND_NONE, 1, 5, 5, 0, 0, false, "B = B"},	//0x40
+	{"MOV B,C", OPERAND_NONE, 1, 5, 5, 0, 0, false, "B = C"},	//0x41
+	{"MOV B,D", OPERAND_NONE, 1, 5, 5, 0, 0, false, "B = D"},	//0x42
+	{"MOV B,E", OPERAND_NONE, 1, 5, 5, 0, 0, false, "B = E"},	//0x43
+	{"MOV B,H", OPERAND_NONE, 1, 5, 5, 0, 0, false, "B = H"},	//0x44
+	{"MOV B,L", OPERAND_NONE, 1, 5, 5, 0, 0, false, "B = L"},	//0x45
+	{"MOV B,M", OPERAND_NONE, 1, 7, 7, 0, 0, false, "B = memory[HL]"},	//0x46
+	{"MOV B,A", OPERAND_NONE, 1, 5, 5, 0, 0, false, "B = A"},	//0x47
+	{"MOV C,B", OPERAND_NONE, 1, 5, 5, 0, 0, false, "C = B"},	//0x48
+	{"MOV C,C", OPERAND_NONE, 1, 5, 5, 0, 0, false, "C = C"},	//0x49
+	{"MOV C,D", OPERAND_NONE, 1, 5, 5, 0, 0, false, "C = D"},	//0x4a
+	{"MOV C,E", OPERAND_NONE, 1, 5, 5, 0, 0, false, "C = E"},	//0x4b
+	{"MOV C,H", OPERAND_NONE, 1, 5, 5, 0, 0, false, "C = H"},	//0x4c
+	{"MOV C,L", OPERAND_NONE, 1, 5, 5, 0, 0, false, "C = L"},	//0x4d
+	{"MOV C,M", OPERAND_NONE, 1, 7, 7, 0, 0, false, "C = memory[HL]"},	//0x4e
+	{"MOV C,A", OPERAND_NONE, 1, 5, 5, 0, 0, false, "C = A"},	//0x4f
+	{"MOV D,B", OPERAND_NONE, 1, 5, 5, 0, 0, false, "D = B"},	//0x50
+	{"MOV D,C", OPERAND_NONE, 1, 5, 5, 0, 0, false, "D = C"},	//0x51
+	{"MOV D,D", OPERAND_NONE, 1, 5, 5, 0, 0, false, "D = D"},	//0x52
+	{"MOV D,E", OPERAND_NONE, 1, 5, 5, 0, 0, false, "D = E"},	//0x53
+	{"MOV D,H", OPERAND_NONE, 1, 5, 5, 0, 0, false, "D = H"},	//0x54
+	{"MOV D,L", OPERAND_NONE, 1, 5, 5, 0, 0, false, "D = L"},	//0x55
+	{"MOV D,M", OPERAND_NONE, 1, 7, 7, 0, 0, false, "D = memory[HL]"},	//0x56
+	{"MOV D,A", OPERAND_NONE, 1, 5, 5, 0, 0, false, "D = A"},	//0x57
+	{"MOV E,B", OPERAND_NONE, 1, 5, 5, 0, 0, false, "E = B"},	//0x58
+	{"MOV E,C", OPERAND_NONE, 1, 5, 5, 0, 0, false, "E = C"},	//0x59
+	{"MOV E,D", OPERAND_NONE, 1, 5, 5, 0, 0, false, "E = D"},	//0x5a
+	{"MOV E,E", OPERAND_NONE, 1, 5, 5, 0, 0, false, "E = E"},	//0x5b
+	{"MOV E,H", OPERAND_NONE, 1, 5, 5, 0, 0, false, "E = H"},	//0x5c
+	{"MOV E,L", OPERAND_NONE, 1, 5, 5, 0, 0, false, "E = L"},	//0x5d
+	{"MOV E,M", OPERAND_NONE, 1, 7, 7, 0, 0, false, "E = memory[HL]"},	//0x5e
+	{"MOV E,A", OPERAND_NONE, 1, 5, 5, 0, 0, false, "E = A"},	//0x5f
+	{"MOV H,B", OPERAND_NONE, 1, 5, 5, 0, 0, false, "H = B"},	//0x60
+	{"MOV H,C", OPERAND_NONE, 1, 5, 5, 0, 0, false, "H = C"},	//0x61
+	{"MOV H,D", OPERAND_NONE, 1, 5, 5, 0, 0, false, "H = D"},	//0x62
+	{"MOV H,E", OPERAND_NONE, 1, 5, 5, 0, 0, false, "H = E"},	//0x63
+	{"MOV H,H", OPERAND_NONE, 1, 5, 5, 0, 0, false, "H = H"},	//0x64
+	{"MOV H,L", OPERAND_NONE, 1, 5, 5, 0, 0, false, "H = L"},	//0x65
+	{"MOV H,M", OPERAND_NONE, 1, 7, 7, 0, 0, false, "H = memory[HL]"},	//0x66
+	{"MOV H,A", OPERAND_NONE, 1, 5, 5, 0, 0, false, "H = A"},	//0x67
+	{"MOV L,B", OPERAND_NONE, 1, 5, 5, 0, 0, false, "L = B"},	//0x68
+	{"MOV L,C", OPERAND_NONE, 1, 5, 5, 0, 0, false, "L = C"},	//0x69
+	{"MOV L,D", OPERAND_NONE, 1, 5, 5, 0, 0, false, "L = D"},	//0x6a
+	{"MOV L,E", OPERAND_NONE, 1, 5, 5, 0, 0, false, "L = E"},	//0x6b
+	{"MOV L,H", OPERAND_NONE, 1, 5, 5, 0, 0, false, "L = H"},	//0x6c
+	{"MOV L,L", OPERAND_NONE, 1, 5, 5, 0, 0, false, "L = L"},	//0x6d
+	{"MOV L,M", OPERAND_NONE, 1, 7, 7, 0, 0, false, "L = memory[HL]"},	//0x6e
+	{"MOV L,A", OPERAND_NONE, 1, 5, 5, 0, 0, false, "L = A"},	//0x6f
+	{"MOV M,B", OPERAND_NONE, 1, 7, 7, 0, 0, false, "memory[HL] = B"},	//0x70
+	{"MOV M,C", OPERAND_NONE, 1, 7, 7, 0, 0, false, "memory[HL] = C"},	//0x71
+	{"MOV M,D", OPERAND_NONE, 1, 7, 7, 0, 0, false, "memory[HL] = D"},	//0x72
+	{"MOV M,E", OPERAND_NONE, 1, 7, 7, 0, 0, false, "memory[HL] = E"},	//0x73
+	{"MOV M,H", OPERAND_NONE, 1, 7, 7, 0, 0, false, "memory[HL] = H"},	//0x74
+	{"MOV M,L", OPERAND_NONE, 1, 7, 7, 0, 0, false, "memory[HL] = L"},	//0x75
+	{"HLT", OPERAND_NONE, 1, 7, 7, 0, 0, true, "Wait for an interrupt"},	//0x76
+	{"MOV M,A", OPERAND_NONE, 1, 7, 7, 0, 0, false, "memory[HL] = A"},	//0x77
+	{"MOV A,B", OPERAND_NONE, 1, 5, 5, 0, 0, false, "A = B"},	//0x78
+	{"MOV A,C", OPERAND_NONE, 1, 5, 5, 0, 0, false, "A = C"},	//0x79
+	{"MOV A,D", OPERAND_NONE, 1, 5, 5, 0, 0, false, "A = D"},	//0x7a
+	{"MOV A,E", OPERAND_NONE, 1, 5, 5, 0, 0, false, "A = E"},	//0x7b
+	{"MOV A,H", OPERAND_NONE, 1, 5, 5, 0, 0, false, "A = H"},	//0x7c
+	{"MOV A,L", OPERAND_NONE, 1, 5, 5, 0, 0, false, "A = L"},	//0x7d
+	{"MOV A,M", OPERAND_NONE, 1, 7, 7, 0, 0, false, "A = memory[HL]"},	//0x7e
+	{"MOV A,A", OPERAND_NONE, 1, 5, 5, 0, 0, false, "A = A"},	//0x7f
+	{"ADD B", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A += B"},	//0x80
+	{"ADD C", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A += C"},	//0x81
+	{"ADD D", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A += D"},	//0x82
+	{"ADD E", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A += E"},	//0x83
+	{"ADD H", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A += H"},	//0x84
+	{"ADD L", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A += L"},	//0x85
+	{"ADD M", OPERAND_NONE, 1, 7, 7, 0, FLAG_MASK, false, "A += memory[HL]"},	//0x86
+	{"ADD A", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A += A"},	//0x87
+	{"ADC B", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A += B + carry"},	//0x88
+	{"ADC C", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A += C + carry"},	//0x89
+	{"ADC D", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A += D + carry"},	//0x8a
+	{"ADC E", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A += E + carry"},	//0x8b
+	{"ADC H", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A += H + carry"},	//0x8c
+	{"ADC L", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A += L + carry"},	//0x8d
+	{"ADC M", OPERAND_NONE, 1, 7, 7, FLAG_CY, FLAG_MASK, false, "A += memory[HL] + carry"},	//0x8e
+	{"ADC A", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A += A + carry"},	//0x8f
+	{"SUB B", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A -= B"},	//0x90
+	{"SUB C", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A -= C"},	//0x91
+	{"SUB D", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A -= D"},	//0x92
+	{"SUB E", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A -= E"},	//0x93
+	{"SUB H", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A -= H"},	//0x94
+	{"SUB L", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A -= L"},	//0x95
+	{"SUB M", OPERAND_NONE, 1, 7, 7, 0, FLAG_MASK, false, "A -= memory[HL]"},	//0x96
+	{"SUB A", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A -= A"},	//0x97
+	{"SBB B", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A -= B + carry"},	//0x98
+	{"SBB C", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A -= C + carry"},	//0x99
+	{"SBB D", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A -= D + carry"},	//0x9a
+	{"SBB E", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A -= E + carry"},	//0x9b
+	{"SBB H", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A -= H + carry"},	//0x9c
+	{"SBB L", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A -= L + carry"},	//0x9d
+	{"SBB M", OPERAND_NONE, 1, 7, 7, FLAG_CY, FLAG_MASK, false, "A -= memory[HL] + carry"},	//0x9e
+	{"SBB A", OPERAND_NONE, 1, 4, 4, FLAG_CY, FLAG_MASK, false, "A -= A + carry"},	//0x9f
+	{"ANA B", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A &= B"},	//0xa0
+	{"ANA C", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A &= C"},	//0xa1
+	{"ANA D", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A &= D"},	//0xa2
+	{"ANA E", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A &= E"},	//0xa3
+	{"ANA H", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A &= H"},	//0xa4
+	{"ANA L", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A &= L"},	//0xa5
+	{"ANA M", OPERAND_NONE, 1, 7, 7, 0, FLAG_MASK, false, "A &= memory[HL]"},	//0xa6
+	{"ANA A", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A &= A"},	//0xa7
+	{"XRA B", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A ^= B"},	//0xa8
+	{"XRA C", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A ^= C"},	//0xa9
+	{"XRA D", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A ^= D"},	//0xaa
+	{"XRA E", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A ^= E"},	//0xab
+	{"XRA H", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A ^= H"},	//0xac
+	{"XRA L", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A ^= L"},	//0xad
+	{"XRA M", OPERAND_NONE, 1, 7, 7, 0, FLAG_MASK, false, "A ^= memory[HL]"},	//0xae
+	{"XRA A", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A ^= A"},	//0xaf
+	{"ORA B", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A |= B"},	//0xb0
+	{"ORA C", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A |= C"},	//0xb1
+	{"ORA D", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A |= D"},	//0xb2
+	{"ORA E", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A |= E"},	//0xb3
+	{"ORA H", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A |= H"},	//0xb4
+	{"ORA L", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A |= L"},	//0xb5
+	{"ORA M", OPERAND_NONE, 1, 7, 7, 0, FLAG_MASK, false, "A |= memory[HL]"},	//0xb6
+	{"ORA A", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "A |= A"},	//0xb7
+	{"CMP B", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "Compare B with A"},	//0xb8
+	{"CMP C", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "Compare C with A"},	//0xb9
+	{"CMP D", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "Compare D with A"},	//0xba
+	{"CMP E", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "Compare E with A"},	//0xbb
+	{"CMP H", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "Compare H with A"},	//0xbc
+	{"CMP L", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "Compare L with A"},	//0xbd
+	{"CMP M", OPERAND_NONE, 1, 7, 7, 0, FLAG_MASK, false, "Compare memory[HL] with A"},	//0xbe
+	{"CMP A", OPERAND_NONE, 1, 4, 4, 0, FLAG_MASK, false, "Compare A with A"},	//0xbf
+	{"RNZ", OPERAND_NONE, 1, 5, 11, FLAG_Z, 0, true, "Return if zero bit = 0"},	//0xc0
+	{"POP B", OPERAND_NONE, 1, 10, 10, 0, 0, false, "C = memory[SP], B = memory[SP+1], SP += 2"},	//0xc1
+	{"JNZ", OPERAND_ADDRESS, 3, 10, 10, FLAG_Z, 0, true, "Jump if zero bit = 0"},	//0xc2
+	{"JMP", OPERAND_ADDRESS, 3, 10, 10, 0, 0, true, "Unconditional jump"},	//0xc3
+	{"CNZ", OPERAND_ADDRESS, 3, 11, 17, FLAG_Z, 0, true, "Call if zero bit = 0"},	//0xc4
+	{"PUSH B", OPERAND_NONE, 1, 11, 11, 0, 0, false, "memory[SP-1] = B, memory[SP-2] = C, SP -= 2"},	//0xc5
+	{"ADI", OPERAND_BYTE, 2, 7, 7, 0, FLAG_MASK, false, "Add immediate"},	//0xc6
+	{"RST 0", OPERAND_NONE, 1, 11, 11, 0, 0, true, "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 0"},	//0xc7
+	{"RZ", OPERAND_NONE, 1, 5, 11, FLAG_Z, 0, true, "Return if zero bit = 1"},	//0xc8
+	{"RET", OPERAND_NONE, 1, 10, 10, 0, 0, true, "Unconditional return"},	//0xc9
+	{"JZ", OPERAND_ADDRESS, 3, 10, 10, FLAG_Z, 0, true, "Jump if zero bit = 1"},	//0xca
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0xcb
+	{"CZ", OPERAND_ADDRESS, 3, 11, 17, FLAG_Z, 0, true, "Call if zero bit = 1"},	//0xcc
+	{"CALL", OPERAND_ADDRESS, 3, 17, 17, 0, 0, true, "Unconditional Call, also special output for diagnostic"},	//0xcd
+	{"ACI", OPERAND_BYTE, 2, 7, 7, FLAG_CY, FLAG_MASK, false, "Add immediate with carry"},	//0xce
+	{"RST 1", OPERAND_NONE, 1, 11, 11, 0, 0, true, "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 8"},	//0xcf
+	{"RNC", OPERAND_NONE, 1, 5, 11, FLAG_CY, 0, true, "Return if carry bit = 0"},	//0xd0
+	{"POP D", OPERAND_NONE, 1, 10, 10, 0, 0, false, "E = memory[SP], D = memory[SP+1], SP += 2"},	//0xd1
+	{"JNC", OPERAND_ADDRESS, 3, 10, 10, FLAG_CY, 0, true, "Jump if carry bit = 0"},	//0xd2
+	{"OUT", OPERAND_BYTE, 2, 10, 10, 0, 0, false, "Output A to port %1"},	//0xd3
+	{"CNC", OPERAND_ADDRESS, 3, 11, 17, FLAG_CY, 0, true, "Call if carry bit = 0"},	//0xd4
+	{"PUSH D", OPERAND_NONE, 1, 11, 11, 0, 0, false, "memory[SP-1] = D, memory[SP-2] = E, SP -= 2"},	//0xd5
+	{"SUI", OPERAND_BYTE, 2, 7, 7, 0, FLAG_MASK, false, "Subtract immediate"},	//0xd6
+	{"RST 2", OPERAND_NONE, 1, 11, 11, 0, 0, true, "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 16"},	//0xd7
+	{"RC", OPERAND_NONE, 1, 5, 11, FLAG_CY, 0, true, "Return if carry bit = 1"},	//0xd8
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0xd9
+	{"JC", OPERAND_ADDRESS, 3, 10, 10, FLAG_CY, 0, true, "Jump if carry bit = 1"},	//0xda
+	{"IN", OPERAND_BYTE, 2, 10, 10, 0, 0, false, "A = input from port %1"},	//0xdb
+	{"CC", OPERAND_ADDRESS, 3, 11, 17, FLAG_CY, 0, true, "Call if carry bit = 1"},	//0xdc
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0xdd
+	{"SBI", OPERAND_BYTE, 2, 7, 7, FLAG_CY, FLAG_MASK, false, "Subtract immediate with borrow"},	//0xde
+	{"RST 3", OPERAND_NONE, 1, 11, 11, 0, 0, true, "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 24"},	//0xdf
+	{"RPO", OPERAND_NONE, 1, 5, 11, FLAG_P, 0, true, "Return if parity bit = 0"},	//0xe0
+	{"POP H", OPERAND_NONE, 1, 10, 10, 0, 0, false, "L = memory[SP], H = memory[SP+1], SP += 2"},	//0xe1
+	{"JPO", OPERAND_ADDRESS, 3, 10, 10, FLAG_P, 0, true, "Jump if parity bit = 0"},	//0xe2
+	{"XTHL", OPERAND_NONE, 1, 18, 18, 0, 0, false, "L <-> memory[SP], H <-> memory[SP+1]"},	//0xe3
+	{"CPO", OPERAND_ADDRESS, 3, 11, 17, FLAG_P, 0, true, "Call if parity bit = 0"},	//0xe4
+	{"PUSH H", OPERAND_NONE, 1, 11, 11, 0, 0, false, "memory[SP-1] = H, memory[SP-2] = L, SP -= 2"},	//0xe5
+	{"ANI", OPERAND_BYTE, 2, 7, 7, 0, FLAG_MASK, false, "AND immediate"},	//0xe6
+	{"RST 4", OPERAND_NONE, 1, 11, 11, 0, 0, true, "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 32"},	//0xe7
+	{"RPE", OPERAND_NONE, 1, 5, 11, FLAG_P, 0, true, "Return if parity bit = 1"},	//0xe8
+	{"PCHL", OPERAND_NONE, 1, 5, 5, 0, 0, true, "(PC highest 8 bits) = H, (PC lowest 8 bits) = L"},	//0xe9
+	{"JPE", OPERAND_ADDRESS, 3, 10, 10, FLAG_P, 0, true, "Jump if parity bit = 1"},	//0xea
+	{"XCHG", OPERAND_NONE, 1, 4, 4, 0, 0, false, "H <-> D, L <-> E"},	//0xeb
+	{"CPE", OPERAND_ADDRESS, 3, 11, 17, FLAG_P, 0, true, "Call if parity bit = 1"},	//0xec
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0xed
+	{"XRI", OPERAND_BYTE, 2, 7, 7, 0, FLAG_MASK, false, "XOR with immediate"},	//0xee
+	{"RST 5", OPERAND_NONE, 1, 11, 11, 0, 0, true, "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 40"},	//0xef
+	{"RP", OPERAND_NONE, 1, 5, 11, FLAG_S, 0, true, "Return if sign bit = 0"},	//0xf0
+	{"POP PSW", OPERAND_NONE, 1, 10, 10, 0, FLAG_MASK, false, "Take flag values off of stack"},	//0xf1
+	{"JP", OPERAND_ADDRESS, 3, 10, 10, FLAG_S, 0, true, "Jump if sign bit = 0"},	//0xf2
+	{"DI", OPERAND_NONE, 1, 4, 4, 0, 0, false, "int_enable = 0"},	//0xf3
+	{"CP", OPERAND_ADDRESS, 3, 11, 17, FLAG_S, 0, true, "Call if sign bit = 0"},	//0xf4
+	{"PUSH PSW", OPERAND_NONE, 1, 11, 11, FLAG_MASK, 0, false, "Push flags to stack"},	//0xf5
+	{"ORI", OPERAND_BYTE, 2, 7, 7, 0, FLAG_MASK, false, "OR immediate"},	//0xf6
+	{"RST 6", OPERAND_NONE, 1, 11, 11, 0, 0, true, "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 48"},	//0xf7
+	{"RM", OPERAND_NONE, 1, 5, 11, FLAG_S, 0, true, "Return if sign bit = 1"},	//0xf8
+	{"SPHL", OPERAND_NONE, 1, 5, 5, 0, 0, false, "SP = HL"},	//0xf9
+	{"JM", OPERAND_ADDRESS, 3, 10, 10, FLAG_S, 0, true, "Jump if sign bit = 1"},	//0xfa
+	{"EI", OPERAND_NONE, 1, 4, 4, 0, 0, false, "int_enable = 1"},	//0xfb
+	{"CM", OPERAND_ADDRESS, 3, 11, 17, FLAG_S, 0, true, "Call if sign bit = 1"},	//0xfc
+	{"NOP", OPERAND_NONE, 1, 4, 4, 0, 0, false, ""},	//0xfd
+	{"CPI", OPERAND_BYTE, 2, 7, 7, 0, FLAG_MASK, false, "Compare immediate"},	//0xfe
+	{"RST 7", OPERAND_NONE, 1, 11, 11, 0, 0, true, "memory[SP-1] = (PC highest 8 bits), memory[SP-2] = (PC lowest 8 bits), SP -= 2, PC = 56"}	//0xff
+};
+
+//Longest any instruction takes, including taken conditional calls
+constexpr uint8_t maxOpCycles(int op = 0, uint8_t longest = 0) {
+	return op == 256 ? longest : maxOpCycles(op + 1, opcodes[op].takenCycles > longest ? opcodes[op].takenCycles : longest);
+}
+
+#endif
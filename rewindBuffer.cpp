@@ -0,0 +1,153 @@
+#include "rewindBuffer.h"
+
+typedef MachineState::Page Page;
+
+//Appends the page number and the xor of the two pages as runs of zeros to
+//skip, a count and that many bytes, until the runs cover the page. Pages that
+//match add nothing, missing pages count as all zeros.
+static void encodePage(std::vector<uint8_t>& delta, uint8_t page, const Page* older, const Page* newer) {
+	uint8_t diff[0x100];
+	bool changed = false;
+	for(unsigned int i = 0; i < 0x100; i++) {
+		diff[i] = (older != nullptr ? (*older)[i] : 0) ^ (newer != nullptr ? (*newer)[i] : 0);
+		changed |= diff[i] != 0;
+	}
+	if(!changed)
+		return;
+
+	delta.push_back(page);
+	unsigned int at = 0;
+	while(at < 0x100) {
+		unsigned int zeros = 0;
+		while(at + zeros < 0x100 && diff[at + zeros] == 0 && zeros < 0xff)
+			zeros++;
+		at += zeros;
+		//Bytes run on until two zeros in a row, which are cheaper skipped
+		unsigned int count = 0;
+		while(at + count < 0x100 && count < 0xff && (diff[at + count] != 0 || (at + count + 1 < 0x100 && diff[at + count + 1] != 0)))
+			count++;
+		delta.push_back(zeros);
+		delta.push_back(count);
+		delta.insert(delta.end(), diff + at, diff + at + count);
+		at += count;
+	}
+}
+
+//Xors a delta from encodePage into pages, copying each page it touches once
+static void applyDelta(const std::vector<uint8_t>& delta, const std::shared_ptr<const Page>* source, std::shared_ptr<Page>* pages) {
+	size_t in = 0;
+	while(in < delta.size()) {
+		const uint8_t page = delta[in++];
+		if(pages[page] == nullptr)
+			pages[page] = source[page] != nullptr ? std::make_shared<Page>(*source[page]) : std::make_shared<Page>(Page{});
+		Page& bytes = *pages[page];
+		unsigned int at = 0;
+		while(at < 0x100) {
+			at += delta[in++];
+			const unsigned int count = delta[in++];
+			for(unsigned int i = 0; i < count; i++)
+				bytes[at++] ^= delta[in++];
+		}
+	}
+}
+
+RewindBuffer::RewindBuffer(MachineState& state, uint64_t interval, size_t budget) : state(state), interval(interval > 0 ? interval : 1), budget(budget) {}
+
+bool RewindBuffer::record() {
+	if(!this->history.empty() && this->state.cycleCount() < this->history.back().cycles + this->interval)
+		return false;
+	this->checkpoint();
+	return true;
+}
+
+void RewindBuffer::checkpoint() {
+	MachineState::Snapshot saved = this->state.snapshot();
+	this->builtIndex = SIZE_MAX; //Indexes move when the oldest are dropped
+	//The old newest checkpoint keeps only what it takes to get back to it.
+	//Pages the machine hasn't written since are the same shared page.
+	if(!this->history.empty()) {
+		std::vector<uint8_t>& delta = this->history.back().delta;
+		for(unsigned int page = 0; page < 256; page++) {
+			if(this->newest[page] != saved.pages[page])
+				encodePage(delta, page, this->newest[page].get(), saved.pages[page].get());
+		}
+		delta.shrink_to_fit();
+		this->used += delta.size();
+	}
+	for(unsigned int page = 0; page < 256; page++)
+		this->newest[page] = saved.pages[page];
+
+	this->history.push_back({saved.psw, saved.bc, saved.de, saved.hl, saved.sp, saved.pc, saved.intEnable, saved.halted,
+								saved.cycles, saved.memorySize, std::move(saved.events), saved.shiftValue, saved.shiftOffset, {}});
+	this->used += sizeof(Checkpoint);
+	while(this->used > this->budget && this->history.size() > 1) {
+		this->used -= sizeof(Checkpoint) + this->history.front().delta.size();
+		this->history.pop_front();
+	}
+}
+
+bool RewindBuffer::rewindTo(uint64_t cycle) {
+	if(this->history.empty() || cycle > this->state.cycleCount() || cycle < this->history.front().cycles)
+		return false;
+	size_t index = this->history.size() - 1;
+	while(this->history[index].cycles > cycle)
+		index--;
+
+	const MachineState::Snapshot saved = this->rebuild(index);
+	this->state.restore(saved);
+
+	//An instruction can't be run part way, so count the whole ones that fit
+	//and, if the next one went past cycle, start again and run one fewer
+	uint64_t steps = 0;
+	while(this->state.cycleCount() < cycle && this->state.runInstruction() != 0)
+		steps++;
+	if(this->state.cycleCount() > cycle) {
+		this->state.restore(saved);
+		for(uint64_t i = 1; i < steps; i++)
+			this->state.runInstruction();
+	}
+
+	//What came after is gone, running forward again records it afresh
+	this->builtIndex = SIZE_MAX;
+	while(this->history.size() > index + 1) {
+		this->used -= sizeof(Checkpoint) + this->history.back().delta.size();
+		this->history.pop_back();
+	}
+	this->used -= this->history.back().delta.size();
+	this->history.back().delta.clear();
+	this->history.back().delta.shrink_to_fit();
+	for(unsigned int page = 0; page < 256; page++)
+		this->newest[page] = saved.pages[page];
+	return true;
+}
+
+MachineState::Snapshot RewindBuffer::rebuild(size_t index) const {
+	//Walk back one delta at a time from the newest memory, or from the last
+	//one rebuilt when that is on the way
+	const bool onTheWay = this->builtIndex != SIZE_MAX && this->builtIndex >= index;
+	const std::shared_ptr<const Page>* from = onTheWay ? this->built : this->newest;
+	std::shared_ptr<Page> changed[256];
+	for(size_t i = onTheWay ? this->builtIndex : this->history.size() - 1; i > index; i--)
+		applyDelta(this->history[i - 1].delta, from, changed);
+	const Checkpoint& found = this->history[index];
+	MachineState::Snapshot saved;
+	for(unsigned int page = 0; page < 256; page++) {
+		saved.pages[page] = changed[page] != nullptr ? changed[page] : from[page];
+		this->built[page] = saved.pages[page];
+	}
+	this->builtIndex = index;
+	saved.psw = found.psw;
+	saved.bc = found.bc;
+	saved.de = found.de;
+	saved.hl = found.hl;
+	saved.sp = found.sp;
+	saved.pc = found.pc;
+	saved.intEnable = found.intEnable;
+	saved.halted = found.halted;
+	saved.cycles = found.cycles;
+	saved.memorySize = found.memorySize;
+	saved.events = found.events;
+	saved.shiftValue = found.shiftValue;
+	saved.shiftOffset = found.shiftOffset;
+	return saved;
+}
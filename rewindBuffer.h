@@ -0,0 +1,77 @@
+#ifndef rewindBuffer_h
+#define rewindBuffer_h
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "machineState.h"
+
+//Lets a machine go back in time. record takes a checkpoint of the whole
+//machine every interval cycles into a ring that drops the oldest ones once
+//they add up to more than budget bytes. Only the newest checkpoint keeps its
+//memory whole, every older one holds the pages that changed on the way to
+//the next one as a run length coded xor of the two, so a checkpoint where a
+//few hundred bytes were written costs a few hundred bytes.
+//
+//rewindTo goes back to the checkpoint at or before a cycle and runs forward
+//from it to the instruction that was executing then. That only lands where
+//the machine really was if everything the program reads comes from memory,
+//scheduled events and the shift register, and idle skip was off while
+//recording, since it changes where instructions fall depending on how run
+//was called.
+class RewindBuffer {
+public:
+	RewindBuffer(MachineState& state, uint64_t interval, size_t budget = 32 << 20);
+
+	//Takes a checkpoint if interval cycles have passed since the last one,
+	//call it between runs. checkpoint takes one regardless.
+	bool record();
+	void checkpoint();
+
+	//Puts the machine on the last instruction boundary at or before cycle and
+	//forgets the checkpoints after it. False, leaving the machine alone, if
+	//cycle is ahead of the machine or older than the oldest checkpoint.
+	bool rewindTo(uint64_t cycle);
+	bool stepBack() { return state.cycleCount() > 0 && rewindTo(state.cycleCount() - 1); }
+
+	//For searching back through history, puts the machine on a checkpoint
+	//without forgetting any of the ones after it
+	void restoreCheckpoint(size_t index) { state.restore(rebuild(index)); }
+	uint64_t checkpointCycles(size_t index) const { return history[index].cycles; }
+
+	size_t checkpoints() const { return history.size(); }
+	size_t bytes() const { return used; } //Approximate size of the history
+	uint64_t oldest() const { return history.empty() ? UINT64_MAX : history.front().cycles; }
+
+private:
+	//A snapshot without its pages, which alone are 4K of pointers
+	struct Checkpoint {
+		uint16_t psw, bc, de, hl, sp, pc;
+		uint8_t intEnable;
+		bool halted;
+		uint64_t cycles;
+		uint32_t memorySize;
+		Scheduler events;
+		uint16_t shiftValue;
+		uint8_t shiftOffset;
+		std::vector<uint8_t> delta; //Pages xored with the next checkpoint's, empty for the newest
+	};
+
+	MachineState& state;
+	const uint64_t interval;
+	const size_t budget;
+	std::deque<Checkpoint> history;
+	std::shared_ptr<const MachineState::Page> newest[256]; //Memory of the last checkpoint
+	size_t used = 0;
+	//Memory of the checkpoint rebuilt last, searches going back one
+	//checkpoint at a time only apply one more delta each
+	mutable size_t builtIndex = SIZE_MAX;
+	mutable std::shared_ptr<const MachineState::Page> built[256];
+
+	MachineState::Snapshot rebuild(size_t index) const;
+};
+
+#endif
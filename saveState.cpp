@@ -0,0 +1,98 @@
+#include "machineState.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "fileReader.h"
+#include "saveState.h"
+#include "shiftRegister.h"
+
+bool MachineState::saveState(const std::string& fileName) const {
+	const std::vector<Scheduler::Timing> timings = this->events.timings();
+	if(timings.size() > SAVE_MAX_EVENTS)
+		return false;
+
+	SaveHeader header = {};
+	std::memcpy(header.magic, SAVE_MAGIC, sizeof(header.magic));
+	header.version = SAVE_VERSION;
+	header.byteOrder = SAVE_BYTE_ORDER;
+	header.headerSize = sizeof(SaveHeader);
+	header.memoryOffset = SAVE_MEMORY_OFFSET;
+	header.memorySize = SAVE_MEMORY_SIZE;
+	header.cycles = this->cycles;
+	header.psw = (this->a << 8) | this->flags();
+	header.bc = this->bc;
+	header.de = this->de;
+	header.hl = this->hl;
+	header.sp = this->sp;
+	header.pc = this->pc;
+	header.intEnable = this->int_enable;
+	header.halted = this->halted;
+	if(this->shiftRegister != nullptr) {
+		header.shiftValue = this->shiftRegister->value;
+		header.shiftOffset = this->shiftRegister->offset;
+	}
+	header.imageEnd = this->memorySize;
+	header.eventCount = timings.size();
+	for(size_t i = 0; i < timings.size(); i++) {
+		header.events[i].due = timings[i].due;
+		header.events[i].period = timings[i].period;
+		header.events[i].id = timings[i].id;
+	}
+
+	//Padding the header out to a whole page keeps the memory page aligned
+	std::vector<char> page(SAVE_MEMORY_OFFSET, 0);
+	std::memcpy(page.data(), &header, sizeof(header));
+	std::ofstream output(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+	output.write(page.data(), page.size());
+	output.write((const char*) this->memory, SAVE_MEMORY_SIZE);
+	output.close();
+	return output.good();
+}
+
+bool MachineState::loadState(const std::string& fileName) {
+	//Everything is read and checked before any of the machine changes, so a
+	//load that fails leaves it as it was
+	FileReader file(fileName);
+	const uint64_t size = file.size();
+	SaveHeader header;
+	if(size < sizeof(header) || !file.read(&header, sizeof(header), 0))
+		return false;
+	if(std::memcmp(header.magic, SAVE_MAGIC, sizeof(header.magic)) != 0 || header.version != SAVE_VERSION
+			|| header.byteOrder != SAVE_BYTE_ORDER || header.headerSize != sizeof(SaveHeader)
+			|| header.memorySize != SAVE_MEMORY_SIZE || header.memoryOffset < sizeof(SaveHeader)
+			|| size < (uint64_t) header.memoryOffset + header.memorySize || header.eventCount > SAVE_MAX_EVENTS
+			|| header.imageEnd > SAVE_MEMORY_SIZE)
+		return false;
+	std::vector<uint8_t> memory(SAVE_MEMORY_SIZE);
+	if(!file.read(memory.data(), memory.size(), header.memoryOffset))
+		return false;
+
+	//retime is the last check and changes nothing when it fails
+	std::vector<Scheduler::Timing> timings(header.eventCount);
+	for(size_t i = 0; i < timings.size(); i++)
+		timings[i] = {header.events[i].due, header.events[i].period, header.events[i].id};
+	if(!this->events.retime(timings))
+		return false;
+
+	std::memcpy(this->memory, memory.data(), memory.size());
+	for(unsigned int page = 0; page < 256; page++)
+		this->pageReplaced(page);
+	this->a = header.psw >> 8;
+	this->setFlags(header.psw & 0xff);
+	this->bc = header.bc;
+	this->de = header.de;
+	this->hl = header.hl;
+	this->sp = header.sp;
+	this->pc = header.pc;
+	this->int_enable = header.intEnable;
+	this->halted = header.halted != 0;
+	this->cycles = header.cycles;
+	this->memorySize = header.imageEnd;
+	if(this->shiftRegister != nullptr) {
+		this->shiftRegister->value = header.shiftValue;
+		this->shiftRegister->offset = header.shiftOffset & 0x07;
+	}
+	return true;
+}
@@ -0,0 +1,43 @@
+#ifndef saveState_h
+#define saveState_h
+
+#include <cstdint>
+
+//Layout of a save state file. A fixed header in the machine's own byte
+//order is followed, at SAVE_MEMORY_OFFSET, by the whole 64K address space,
+//so the memory starts on a page boundary and the file can be mapped and
+//read where it lies. Changing anything here means a new SAVE_VERSION.
+static const char SAVE_MAGIC[8] = {'8', '0', '8', '0', 'S', 'A', 'V', 'E'};
+static const uint32_t SAVE_VERSION = 2;
+static const uint16_t SAVE_BYTE_ORDER = 0x0102; //Reads back as 0x0201 on a host of the other order
+static const uint32_t SAVE_MEMORY_OFFSET = 4096;
+static const uint32_t SAVE_MEMORY_SIZE = 0x10000;
+static const unsigned int SAVE_MAX_EVENTS = 32;
+
+struct SaveHeader {
+	char magic[8];
+	uint32_t version;
+	uint16_t byteOrder;
+	uint16_t headerSize; //sizeof(SaveHeader)
+	uint32_t memoryOffset;
+	uint32_t memorySize;
+	uint64_t cycles;
+	uint16_t psw, bc, de, hl, sp, pc; //A in the high byte of psw, the flags packed in the low
+	uint8_t intEnable;
+	uint8_t halted;
+	uint8_t shiftOffset;
+	uint8_t eventCount;
+	uint16_t shiftValue;
+	uint16_t reserved;
+	uint32_t imageEnd; //End of the loaded image, what isDone compares pc against
+	struct {
+		uint64_t due;
+		uint64_t period; //0 for one shot events
+		uint64_t id; //What the scheduler matches it to a pending event by
+	} events[SAVE_MAX_EVENTS]; //In the order the scheduler breaks ties
+};
+
+static_assert(sizeof(SaveHeader) == 824, "save state header layout changed");
+static_assert(sizeof(SaveHeader) <= SAVE_MEMORY_OFFSET, "save state header overlaps the memory");
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef scheduler_h
+#define scheduler_h
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+//Callbacks due at a clock cycle count. They sit in a min-heap on the due
+//cycle, so while running only the earliest one ever has to be looked at.
+class Scheduler {
+public:
+	typedef std::function<void()> Action;
+
+	//Runs action once the cycle count reaches due
+	void at(uint64_t due, Action action) { this->add(due, 0, this->nextId++, std::move(action)); }
+
+	//Runs action at first and every period cycles after it. Each time is
+	//counted from when the last one was due, not when it ran, so it never drifts.
+	void every(uint64_t first, uint64_t period, Action action) { this->add(first, period, this->nextId++, std::move(action)); }
+
+	//When each pending event is next due, its period and its id, in the
+	//order they break ties. Ids count the calls to at and every since the
+	//last clear and stay with an event as it repeats. Actions are code rather
+	//than state, so a saved schedule can only be put back with retime on a
+	//scheduler holding the same events added the same way. It matches them
+	//up by id and is false, changing nothing, if any don't match.
+	struct Timing {
+		uint64_t due;
+		uint64_t period;
+		uint64_t id;
+	};
+	std::vector<Timing> timings() const {
+		std::vector<Timing> saved;
+		for(size_t index : this->byOrder())
+			saved.push_back({this->events[index].due, this->events[index].period, this->events[index].id});
+		return saved;
+	}
+	bool retime(const std::vector<Timing>& saved) {
+		if(saved.size() != this->events.size())
+			return false;
+		std::vector<size_t> matched(saved.size());
+		std::vector<bool> used(this->events.size(), false);
+		for(size_t i = 0; i < saved.size(); i++) {
+			size_t index = 0;
+			while(index < this->events.size() && this->events[index].id != saved[i].id)
+				index++;
+			if(index == this->events.size() || used[index] || this->events[index].period != saved[i].period)
+				return false;
+			used[index] = true;
+			matched[i] = index;
+		}
+		//Ties are broken by the saved order, so events are renumbered in it
+		for(size_t i = 0; i < saved.size(); i++) {
+			this->events[matched[i]].due = saved[i].due;
+			this->events[matched[i]].order = this->added++;
+		}
+		std::make_heap(this->events.begin(), this->events.end(), later);
+		return true;
+	}
+
+	void clear() {
+		this->events.clear();
+		this->nextId = 0;
+	}
+	uint64_t next() const { return this->events.empty() ? UINT64_MAX : this->events.front().due; }
+
+	//Runs every event due at or before now, earliest first and in the order
+	//they were added when due together
+	void runDue(uint64_t now) {
+		while(!this->events.empty() && this->events.front().due <= now) {
+			std::pop_heap(this->events.begin(), this->events.end(), later);
+			Event event = std::move(this->events.back());
+			this->events.pop_back();
+			event.action();
+			if(event.period != 0)
+				this->add(event.due + event.period, event.period, event.id, std::move(event.action));
+		}
+	}
+
+private:
+	struct Event {
+		uint64_t due;
+		uint64_t order; //Breaks ties between events due on the same cycle
+		uint64_t id;
+		uint64_t period; //0 for one shot events
+		Action action;
+	};
+
+	void add(uint64_t due, uint64_t period, uint64_t id, Action action) {
+		this->events.push_back({due, this->added++, id, period, std::move(action)});
+		std::push_heap(this->events.begin(), this->events.end(), later);
+	}
+
+	//Indexes of the events in the order they break ties
+	std::vector<size_t> byOrder() const {
+		std::vector<size_t> sorted(this->events.size());
+		for(size_t i = 0; i < sorted.size(); i++)
+			sorted[i] = i;
+		std::sort(sorted.begin(), sorted.end(), [this](size_t left, size_t right) { return this->events[left].order < this->events[right].order; });
+		return sorted;
+	}
+
+	static bool later(const Event& left, const Event& right) {
+		return left.due != right.due ? left.due > right.due : left.order > right.order;
+	}
+
+	std::vector<Event> events;
+	uint64_t added = 0;
+	uint64_t nextId = 0;
+};
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef shiftRegister_h
+#define shiftRegister_h
+
+#include "machineState.h"
+
+//The Space Invaders shift register. A write to the data port shifts a byte
+//in from the top of the 16 bit register, a write to the offset port picks
+//which 8 bits the result port reads, counted down from the top. Attached
+//with mapShiftRegister the bus calls it directly instead of through in and out.
+class ShiftRegister final : public PortDevice {
+public:
+	ShiftRegister(uint8_t offsetPort = 2, uint8_t resultPort = 3, uint8_t dataPort = 4)
+		: offsetPort(offsetPort), resultPort(resultPort), dataPort(dataPort) {}
+
+	uint8_t read() const { return (uint8_t) (this->value >> (8 - this->offset)); }
+	void write(uint8_t port, uint8_t data) {
+		if(port == this->offsetPort)
+			this->offset = data & 0x07;
+		else
+			this->value = (data << 8) | (this->value >> 8);
+	}
+
+	uint8_t in(uint8_t) override { return this->read(); }
+	void out(uint8_t port, uint8_t data) override { this->write(port, data); }
+
+	const uint8_t offsetPort, resultPort, dataPort;
+
+private:
+	friend class MachineState; //The JIT works on value and offset directly
+	uint16_t value = 0;
+	uint8_t offset = 0;
+};
+
+#endif
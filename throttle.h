@@ -0,0 +1,53 @@
+#ifndef throttle_h
+#define throttle_h
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+//Holds emulated time to the wall clock by sleeping between slices of
+//emulation. Every deadline is worked out from when the clock started and
+//the total cycles run since, never from the previous wake up, so a sleep
+//that overran is made up on the next slice instead of adding up.
+class Throttle {
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	explicit Throttle(uint64_t hz) : hz(hz) {}
+
+	void start(uint64_t cycles) {
+		this->startCycles = cycles;
+		this->startTime = Clock::now();
+	}
+
+	//Sleeps until the wall clock reaches the time cycles stands for
+	void wait(uint64_t cycles) {
+		const Clock::time_point deadline = this->startTime + std::chrono::duration_cast<Clock::duration>(
+				std::chrono::duration<double>((double)(cycles - this->startCycles) / this->hz));
+		const Clock::time_point now = Clock::now();
+		if(now < deadline) {
+			std::this_thread::sleep_until(deadline);
+			return;
+		}
+		//Falling far behind, say after the host was suspended, starts the
+		//clock again rather than running flat out to catch up
+		const std::chrono::milliseconds maxLag(250);
+		this->lateSlices++;
+		if(now - deadline > maxLag) {
+			this->resyncs++;
+			this->start(cycles);
+		}
+	}
+
+	uint64_t late() const { return lateSlices; } //Slices that ended past their deadline
+	uint64_t restarts() const { return resyncs; }
+
+private:
+	const uint64_t hz;
+	uint64_t startCycles = 0;
+	Clock::time_point startTime = Clock::now();
+	uint64_t lateSlices = 0;
+	uint64_t resyncs = 0;
+};
+
+#endif
@@ -0,0 +1,300 @@
+#include "video.h"
+
+#include <cstring>
+#include <fstream>
+
+#include "machineState.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+//The AVX2 kernels are compiled in on any x86 GCC or clang build and only used
+//when the CPU running them has AVX2
+#if defined(__SSE2__) && defined(__GNUC__)
+#define HAVE_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+//Bytes of VRAM per column of the turned screen
+static const int COLUMN_BYTES = Video::HEIGHT / 8;
+
+static const uint8_t palette[4][3] = {
+	{0x00, 0x00, 0x00},	//COLOR_BLACK
+	{0xff, 0xff, 0xff},	//COLOR_WHITE
+	{0xff, 0x20, 0x20},	//COLOR_RED
+	{0x20, 0xff, 0x20}	//COLOR_GREEN
+};
+
+static uint32_t toRGBA(Video::Color color) {
+	const uint8_t bytes[4] = {palette[color][0], palette[color][1], palette[color][2], 0xff};
+	uint32_t pixel;
+	std::memcpy(&pixel, bytes, sizeof(pixel));
+	return pixel;
+}
+
+//What a cleared bit turns into
+template<typename Pixel> static Pixel black();
+template<> uint8_t black<uint8_t>() { return Video::COLOR_BLACK; }
+template<> uint32_t black<uint32_t>() { return toRGBA(Video::COLOR_BLACK); }
+
+//Kernels convert one strip of STRIP columns, working down it a row at a
+//time. Row b of a strip is byte b of each of its columns, 8 screen rows
+//counted up from the bottom.
+typedef uint8_t Rows[COLUMN_BYTES][Video::STRIP];
+
+#if defined(__SSE2__)
+//Turns 16 rows of 16 bytes into 16 columns, four rounds of interleaving
+//row i with row i + 8 move every byte to its transposed place
+static inline void transpose(__m128i* rows) {
+	for(int round = 0; round < 4; round++) {
+		__m128i interleaved[16];
+		for(int i = 0; i < 8; i++) {
+			interleaved[i * 2] = _mm_unpacklo_epi8(rows[i], rows[i + 8]);
+			interleaved[i * 2 + 1] = _mm_unpackhi_epi8(rows[i], rows[i + 8]);
+		}
+		for(int i = 0; i < 16; i++)
+			rows[i] = interleaved[i];
+	}
+}
+
+//Transposes the strip in 16 by 16 byte blocks, so VRAM is never read a byte
+//at a time with a 32 byte stride
+static void gatherRows(const uint8_t* vram, int x, Rows& rows) {
+	for(int column = 0; column < Video::STRIP; column += 16) {
+		for(int half = 0; half < COLUMN_BYTES; half += 16) {
+			__m128i block[16];
+			for(int i = 0; i < 16; i++)
+				block[i] = _mm_loadu_si128((const __m128i*)(vram + (x + column + i) * COLUMN_BYTES + half));
+			transpose(block);
+			for(int i = 0; i < 16; i++)
+				_mm_store_si128((__m128i*)(rows[half + i] + column), block[i]);
+		}
+	}
+}
+#else
+static void gatherRows(const uint8_t* vram, int x, Rows& rows) {
+	for(int column = 0; column < Video::STRIP; column++) {
+		for(int b = 0; b < COLUMN_BYTES; b++)
+			rows[b][column] = vram[(x + column) * COLUMN_BYTES + b];
+	}
+}
+#endif
+
+template<typename Pixel>
+static void renderScalar(const uint8_t* vram, const Pixel* overlay, Pixel* pixels, int x) {
+	alignas(32) Rows rows;
+	gatherRows(vram, x, rows);
+	const Pixel unlit = black<Pixel>();
+	for(int b = 0; b < COLUMN_BYTES; b++) {
+		for(int bit = 0; bit < 8; bit++) {
+			const int y = Video::HEIGHT - 1 - (b * 8 + bit);
+			const Pixel* colors = overlay + y * Video::WIDTH + x;
+			Pixel* out = pixels + y * Video::WIDTH + x;
+			for(int i = 0; i < Video::STRIP; i++)
+				out[i] = unlit ^ (colors[i] & (Pixel)(0 - ((rows[b][i] >> bit) & 1)));
+		}
+	}
+}
+
+#if defined(__SSE2__)
+//Stores 16 pixels given a byte per pixel that is 0xff when lit
+static inline void storeLit(__m128i lit, const uint8_t* colors, uint8_t* out) {
+	const __m128i color = _mm_loadu_si128((const __m128i*)colors);
+	_mm_storeu_si128((__m128i*)out, _mm_and_si128(lit, color));
+}
+
+//Two rounds of unpacking widen the byte masks to 32 bits
+static inline void storeLit(__m128i lit, const uint32_t* colors, uint32_t* out) {
+	const __m128i unlit = _mm_set1_epi32((int)black<uint32_t>());
+	const __m128i low = _mm_unpacklo_epi8(lit, lit), high = _mm_unpackhi_epi8(lit, lit);
+	const __m128i lit32[4] = {_mm_unpacklo_epi16(low, low), _mm_unpackhi_epi16(low, low),
+								_mm_unpacklo_epi16(high, high), _mm_unpackhi_epi16(high, high)};
+	for(int i = 0; i < 4; i++) {
+		const __m128i color = _mm_loadu_si128((const __m128i*)(colors + i * 4));
+		_mm_storeu_si128((__m128i*)(out + i * 4), _mm_xor_si128(unlit, _mm_and_si128(lit32[i], color)));
+	}
+}
+
+//16 pixels at a time, comparing the masked bytes gives 0xff for every lit one
+template<typename Pixel>
+static void renderSSE2(const uint8_t* vram, const Pixel* overlay, Pixel* pixels, int x) {
+	alignas(32) Rows rows;
+	gatherRows(vram, x, rows);
+	for(int b = 0; b < COLUMN_BYTES; b++) {
+		for(int bit = 0; bit < 8; bit++) {
+			const int y = Video::HEIGHT - 1 - (b * 8 + bit);
+			const __m128i mask = _mm_set1_epi8((char)(1 << bit));
+			for(int i = 0; i < Video::STRIP; i += 16) {
+				const __m128i bits = _mm_and_si128(_mm_load_si128((const __m128i*)(rows[b] + i)), mask);
+				storeLit(_mm_cmpeq_epi8(bits, mask), overlay + y * Video::WIDTH + x + i, pixels + y * Video::WIDTH + x + i);
+			}
+		}
+	}
+}
+#endif
+
+#ifdef HAVE_AVX2_KERNEL
+__attribute__((target("avx2")))
+static inline void storeLit(__m256i lit, const uint8_t* colors, uint8_t* out) {
+	const __m256i color = _mm256_loadu_si256((const __m256i*)colors);
+	_mm256_storeu_si256((__m256i*)out, _mm256_and_si256(lit, color));
+}
+
+//Sign extending 8 mask bytes at a time widens them to 32 bits
+__attribute__((target("avx2")))
+static inline void storeLit(__m256i lit, const uint32_t* colors, uint32_t* out) {
+	const __m256i unlit = _mm256_set1_epi32((int)black<uint32_t>());
+	const __m128i low = _mm256_castsi256_si128(lit), high = _mm256_extracti128_si256(lit, 1);
+	const __m256i lit32[4] = {_mm256_cvtepi8_epi32(low), _mm256_cvtepi8_epi32(_mm_srli_si128(low, 8)),
+								_mm256_cvtepi8_epi32(high), _mm256_cvtepi8_epi32(_mm_srli_si128(high, 8))};
+	for(int i = 0; i < 4; i++) {
+		const __m256i color = _mm256_loadu_si256((const __m256i*)(colors + i * 8));
+		_mm256_storeu_si256((__m256i*)(out + i * 8), _mm256_xor_si256(unlit, _mm256_and_si256(lit32[i], color)));
+	}
+}
+
+//A whole strip row in one register
+template<typename Pixel>
+__attribute__((target("avx2")))
+static void renderAVX2(const uint8_t* vram, const Pixel* overlay, Pixel* pixels, int x) {
+	alignas(32) Rows rows;
+	gatherRows(vram, x, rows);
+	for(int b = 0; b < COLUMN_BYTES; b++) {
+		for(int bit = 0; bit < 8; bit++) {
+			const int y = Video::HEIGHT - 1 - (b * 8 + bit);
+			const __m256i mask = _mm256_set1_epi8((char)(1 << bit));
+			const __m256i bits = _mm256_and_si256(_mm256_load_si256((const __m256i*)rows[b]), mask);
+			storeLit(_mm256_cmpeq_epi8(bits, mask), overlay + y * Video::WIDTH + x, pixels + y * Video::WIDTH + x);
+		}
+	}
+}
+#endif
+
+//Picks the widest kernel this build and CPU can run
+template<typename Pixel>
+static void (*pickKernel())(const uint8_t*, const Pixel*, Pixel*, int) {
+#ifdef HAVE_AVX2_KERNEL
+	if(__builtin_cpu_supports("avx2"))
+		return renderAVX2<Pixel>;
+#endif
+#if defined(__SSE2__)
+	return renderSSE2<Pixel>;
+#else
+	return renderScalar<Pixel>;
+#endif
+}
+
+Video::Video(Format format) : pixelFormat(format) {
+	if(format == FORMAT_RGBA) {
+		this->rgba.kernel = pickKernel<uint32_t>();
+		this->rgba.overlay.resize(WIDTH * HEIGHT);
+		this->rgba.pixels.assign(WIDTH * HEIGHT, black<uint32_t>());
+	}
+	else {
+		this->indexed.kernel = pickKernel<uint8_t>();
+		this->indexed.overlay.resize(WIDTH * HEIGHT);
+		this->indexed.pixels.assign(WIDTH * HEIGHT, COLOR_BLACK);
+	}
+	this->setOverlay(true);
+}
+
+//Red across the top where the saucer flies, green over the shields and the
+//player, and over the reserve ships at the bottom left
+void Video::setOverlay(bool enabled) {
+	this->watched = nullptr; //Every pixel may need its new color
+	for(int y = 0; y < HEIGHT; y++) {
+		for(int x = 0; x < WIDTH; x++) {
+			Color color = COLOR_WHITE;
+			if(enabled && y >= 32 && y < 64)
+				color = COLOR_RED;
+			else if(enabled && ((y >= 184 && y < 240) || (y >= 240 && x >= 16 && x < 134)))
+				color = COLOR_GREEN;
+			if(this->pixelFormat == FORMAT_RGBA)
+				this->rgba.overlay[y * WIDTH + x] = toRGBA(color) ^ black<uint32_t>();
+			else
+				this->indexed.overlay[y * WIDTH + x] = color ^ black<uint8_t>();
+		}
+	}
+}
+
+void Video::render(const MachineState& state) {
+	this->render(state.getMemory() + VRAM_START);
+}
+
+void Video::render(const uint8_t* vram) {
+	for(int x = 0; x < WIDTH; x += STRIP)
+		this->renderStrip(vram, x);
+}
+
+//The first call starts watching VRAM and converts everything, after that
+//only strips with a column written since the last call
+bool Video::update(MachineState& state) {
+	const uint8_t* vram = state.getMemory() + VRAM_START;
+	if(this->watched != &state) {
+		state.watchWrites(VRAM_START, VRAM_SIZE);
+		this->watched = &state;
+		this->seenWrites = state.watchedWrites();
+		this->render(vram);
+		return true;
+	}
+	if(state.watchedWrites() == this->seenWrites)
+		return false;
+
+	bool changed = false;
+	for(int x = 0; x < WIDTH; x += STRIP) {
+		for(int column = x; column < x + STRIP; column++) {
+			if(state.lineWritten(VRAM_START + column * COLUMN_BYTES) > this->seenWrites) {
+				this->renderStrip(vram, x);
+				changed = true;
+				break;
+			}
+		}
+	}
+	this->seenWrites = state.watchedWrites();
+	return changed;
+}
+
+void Video::renderStrip(const uint8_t* vram, int x) {
+	if(this->pixelFormat == FORMAT_RGBA)
+		this->rgba.kernel(vram, this->rgba.overlay.data(), this->rgba.pixels.data(), x);
+	else
+		this->indexed.kernel(vram, this->indexed.overlay.data(), this->indexed.pixels.data(), x);
+}
+
+const uint8_t* Video::frame() const {
+	if(this->pixelFormat == FORMAT_RGBA)
+		return (const uint8_t*)this->rgba.pixels.data();
+	return this->indexed.pixels.data();
+}
+
+const uint8_t* Video::rgb(Color color) {
+	return palette[color];
+}
+
+//Binary PPM, without the alpha channel
+bool Video::savePPM(const std::string& fileName) const {
+	std::ofstream output(fileName, std::ios::out | std::ios::binary);
+	output << "P6\n" << WIDTH << " " << HEIGHT << "\n255\n";
+	std::vector<char> bytes(WIDTH * HEIGHT * 3);
+	const uint8_t* pixels = this->frame();
+	for(int i = 0; i < WIDTH * HEIGHT; i++) {
+		if(this->pixelFormat == FORMAT_RGBA)
+			std::memcpy(&bytes[i * 3], pixels + i * 4, 3);
+		else
+			std::memcpy(&bytes[i * 3], palette[pixels[i]], 3);
+	}
+	output.write(bytes.data(), bytes.size());
+	return output.good();
+}
+
+const char* Video::kernelName() const {
+#ifdef HAVE_AVX2_KERNEL
+	if(__builtin_cpu_supports("avx2"))
+		return "avx2";
+#endif
+#if defined(__SSE2__)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
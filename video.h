@@ -0,0 +1,61 @@
+#ifndef video_h
+#define video_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class MachineState;
+
+//Space Invaders video. VRAM at 0x2400-0x3fff is 1 bit per pixel, 224 columns
+//of 256 pixels with the bottom of the column in bit 0 of the first byte. The
+//monitor is turned on its side, so frames come out 224 wide and 256 high.
+class Video {
+public:
+	static const int WIDTH = 224;
+	static const int HEIGHT = 256;
+	static const uint16_t VRAM_START = 0x2400;
+	static const uint16_t VRAM_SIZE = WIDTH * HEIGHT / 8;
+	static const int STRIP = 32; //Columns converted together, also what update redraws
+
+	enum Format {
+		FORMAT_RGBA,	//4 bytes per pixel in R, G, B, A order
+		FORMAT_INDEXED	//1 byte per pixel holding a Color, a quarter of the memory traffic
+	};
+	enum Color : uint8_t { COLOR_BLACK, COLOR_WHITE, COLOR_RED, COLOR_GREEN };
+
+	Video(Format format = FORMAT_RGBA);
+
+	//The cellophane strips on the cabinet glass, without them every lit pixel is white
+	void setOverlay(bool enabled);
+
+	void render(const MachineState& state);
+	void render(const uint8_t* vram);
+	//Converts only the strips written since the last update, watching the
+	//state's VRAM for writes from the first call on. False if nothing changed.
+	bool update(MachineState& state);
+	const uint8_t* frame() const; //WIDTH * HEIGHT pixels, top row first
+	Format format() const { return pixelFormat; }
+	static const uint8_t* rgb(Color color); //Red, green and blue of a palette entry
+
+	bool savePPM(const std::string& fileName) const;
+
+	const char* kernelName() const; //Conversion picked for this CPU
+
+private:
+	template<typename Pixel> struct Buffers {
+		void (*kernel)(const uint8_t* vram, const Pixel* overlay, Pixel* pixels, int x);
+		std::vector<Pixel> overlay; //Color of each pixel when lit, xored with black
+		std::vector<Pixel> pixels;
+	};
+
+	Format pixelFormat;
+	Buffers<uint32_t> rgba;
+	Buffers<uint8_t> indexed;
+	MachineState* watched = nullptr;
+	uint64_t seenWrites = 0; //watchedWrites at the last update
+
+	void renderStrip(const uint8_t* vram, int x);
+};
+
+#endif